@@ -9,6 +9,11 @@
  * 
  * OBJETIVO: Alocar disciplinas a períodos e salas respeitando restrições
  * REPRESENTAÇÃO: Matriz [períodos x salas] onde cada célula contém uma disciplina
+ * 
+ * COMPILAÇÃO: gcc main.c -o main -lm -lpthread
+ *   -DVERIFICA_INVARIANTES: confere R1/R3 e a representação a cada vizinho
+ *   -DCONTADORES_HW: contadores de hardware por fase (Linux, perf_event_open)
+ *   -DSONDAS: tempo e chamadas das funções mais usadas, somados no fim
  * ============================================================================
  */
 
@@ -17,6 +22,20 @@
 #include <time.h>
 #include <math.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <poll.h>
+#ifdef CONTADORES_HW
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 
 // ============================================================================
 // CONSTANTES GLOBAIS
@@ -25,6 +44,64 @@
 #define SIZE 100          // Tamanho máximo para strings (nomes, etc)
 #define SAIDA 1024        // Tamanho do buffer de saída
 #define HISTORICO 10      // Quantidade de soluções a guardar no histórico
+#define PROB_COMPOSTO 100 // Chance (em 1000) de usar um movimento composto no SA
+#define MAX_THREADS 16    // Limite de threads das fases paralelas
+#define DURACAO_TABU 1000 // Quantos estados aceitos recentes o SA lembra
+#define TAM_ELITE 8       // Soluções guardadas no conjunto elite
+#define DIST_MIN_ELITE 10 // Distância mínima (células) entre soluções elite
+#define AMOSTRA_RELIGACAO 8  // Trocas avaliadas por passo da religação de caminhos
+#define ANCORAS_POLIMENTO 4  // Células-âncora por thread em cada bloco do polimento
+#define TEMP_DECOMPOSICAO 100.0 // Temperatura inicial do SA de cada componente
+#define PASSOS_DECOMPOSICAO 20  // Iterações por aula em cada temperatura (componentes)
+#define INTERVALO_CHECKPOINT 50 // Passos de temperatura entre checkpoints do SA
+#define PRAZO_ESCALA 60.0       // Segundos de SA por tamanho no teste de escala
+#define JANELA_MEDICAO 0.2      // Segundos de cada medição de custo no teste de escala
+#define MAX_TAMANHOS 32         // Tamanhos aceitos em um teste de escala
+#define NUM_FAIXAS_T 6          // Faixas de temperatura do SA (iterações e resfriamento)
+#define NUM_FAIXAS_VIZ 9        // Limites das faixas de movimento do geraViz (em 1000)
+#define MAX_INSTANCIAS 64       // Instâncias aceitas na corrida de parâmetros
+#define CONFIGURACOES_AJUSTE 16 // Configurações sorteadas na corrida de parâmetros
+#define PRAZO_AJUSTE 10.0       // Segundos de SA por execução na corrida
+#define ETAPAS_MINIMAS 5        // Instâncias antes do primeiro teste de eliminação
+#define NUM_CARACTERISTICAS 4   // Características da instância (ver CARACTERÍSTICAS DA INSTÂNCIA)
+#define MAX_PERFIS 64           // Perfis de parâmetros na tabela lida com -P
+#define REINICIO_NENHUM 0       // Estratégias de reinício do SA (ver REINÍCIOS DO SA)
+#define REINICIO_LUBY 1
+#define REINICIO_GEOMETRICO 2
+#define ORCAMENTO_REINICIO 300.0 // Segundos de SA por grade com reinícios
+#define UNIDADE_REINICIO 5.0    // Segundos do episódio de tamanho 1
+#define RAZAO_REINICIO 1.5      // Razão entre episódios na sequência geométrica
+#define TEMP_REINICIO 10.0      // Temperatura inicial dos episódios que partem da elite
+#define TEMP_PARTIDA 1.0        // Temperatura inicial do SA que parte de uma grade anterior (-w)
+#define PRAZO_PARTIDA 30.0      // Segundos de SA da grade que parte de uma anterior (sem -s)
+#define LINHA_PARTIDA 65536     // Caracteres por linha lidos da grade anterior
+#define AMOSTRA_DELTAS 256      // Deltas de piora recentes que definem a temperatura de reaquecimento
+#define INTERVALO_INCUMBENTE 2.0 // Segundos mínimos entre gravações da melhor solução
+#define DESPEJO_PARCIAL 1       // Destino do despejo: <saida>.parcial (SIGUSR1)
+#define DESPEJO_INCUMBENTE 2    // Destino do despejo: <saida>.melhor (a cada melhora)
+#define TAM_LOG 4096            // Eventos na fila do log assíncrono
+#define LOG_ERRO 0              // Níveis do log (ver REGISTRO ASSÍNCRONO)
+#define LOG_AVISO 1
+#define LOG_INFO 2
+#define LOG_DEPURACAO 3
+#define TRACO_MELHORA 0         // Registro do traço: nova melhor solução
+#define TRACO_AMOSTRA 1         // Registro do traço: amostra do fim de um passo de temperatura
+#define TRACO_NENHUM 0          // Formatos do traço de convergência
+#define TRACO_BINARIO 1
+#define TRACO_CSV 2
+#define FASE_LEITURA 0          // Fases medidas pelos contadores de hardware
+#define FASE_CONSTRUCAO 1
+#define FASE_PASSO_SA 2
+#define FASE_AVALIACAO 3
+#define FASE_MOVIMENTO 4
+#define NUM_FASES 5
+#define NUM_CONTADORES 4        // Ciclos, instruções, faltas de cache, desvios mal previstos
+#define SONDA_CALCULA_FO 0      // Funções medidas pelas sondas de tempo
+#define SONDA_GERAVIZ 1
+#define SONDA_COPIAMATRIZ 2
+#define SONDA_R6 3
+#define SONDA_R4 4
+#define NUM_SONDAS 5
 
 // ============================================================================
 // RESTRIÇÕES DO PROBLEMA
@@ -34,7 +111,8 @@
  * RESTRIÇÕES GRAVES (Hard Constraints) - Penalização: 1.000.000 pontos
  * 
  * R1 - AULAS: Todas as aulas devem ser agendadas no número correto
- *      Violação: aula não agendada ou agendada em excesso
+ *      Violação: aula não agendada ou agendada em excesso (garantida pelos
+ *      movimentos: só há trocas de células, ver verificaInvariantes)
  * 
  * R2 - CONFLITOS: Aulas do mesmo curso ou professor não podem coincidir
  *      Violação: duas ou mais aulas conflitantes no mesmo período
@@ -79,10 +157,16 @@
  * MATRIZ: Representa uma solução completa do problema
  * - n: matriz [período][sala] = id_disciplina (-1 se vazio)
  * - fo: valor da função objetivo (soma de todas as penalidades)
+ * - hash: assinatura de Zobrist da grade (atualizada a cada troca)
+ * - a/pos: representação dual por aula (aula -> célula e célula -> aula),
+ *   mantida em sincronia com n por trocaCelulas
  */
 typedef struct matriz{
-	int fo;              // Função Objetivo (fitness da solução)
+	long long fo;        // Função Objetivo (fitness da solução)
 	int** n;             // Matriz de alocação [total_periodos][salas]
+	unsigned long long hash;  // Hash de Zobrist da grade
+	int** a;             // Aula (ID) em cada célula [total_periodos][salas] (-1 se vazio)
+	int* pos;            // Célula de cada aula (período * salas + sala) [total_aulas]
 }Matriz;
 
 /*
@@ -104,6 +188,8 @@ typedef struct disciplina{
 	int  minDias;        // Número mínimo de dias que a disciplina deve aparecer (R5)
 	int  alunos;         // Número de alunos matriculados (para R7)
 	int  tipo_sala;      // Tipo de sala
+	int  qtCursos;       // Quantidade de cursos a que pertence
+	int* listaCursos;    // IDs dos cursos em ordem crescente [qtCursos]
 }Disciplina;
 
 /*
@@ -141,7 +227,7 @@ typedef struct restricao{
 int execucao;                              // Número da execução atual
 int rotina = 0;                            // Contador de rotinas executadas
 int programa;                              // Contador de programas/instâncias
-int mat_solucao_tempo[HISTORICO][2];      // Histórico [i][0]=FO, [i][1]=tempo
+long long mat_solucao_tempo[HISTORICO][2];  // Histórico [i][0]=FO, [i][1]=tempo
 int aux_mat = 0;                           // Índice circular para histórico
 int num_exec = 1;                          // Número total de execuções planejadas
 
@@ -153,7 +239,6 @@ Curso *curso;             // Vetor de cursos
 Restricao *restricao;     // Vetor de restrições de indisponibilidade
 
 // Variáveis de controle das restrições
-int* r1;                  // [disciplinas] - Conta aulas agendadas por disciplina (R1)
 int** r21;                // [total_periodos][professores] - Aulas por professor/período (R2)
 int** r22;                // [total_periodos][cursos] - Disciplinas por curso/período (R2)
 int** r5;                 // [disciplinas][dias] - Marca dias com aula de cada disciplina (R5)
@@ -162,6 +247,7 @@ int** r9;                 // [professores][dias] - Marca dias com aula de cada d
 int** r11;                 // [dias][disciplinas] - Marca quais disciplinas tem no dia (R11)
 
 int restricoes_violadas[12];  // Contador de violações por tipo de restrição
+long long penalidades[12];    // Penalidade por restrição na última calcula_FO
 int* posicao_restricao[2];   // [0]=início, [1]=fim das restrições por disciplina
 int ** dias_ocupados_integral;     // [professores][dias] - recebido da integral
 int  usar_restricao_integral = 0;  // Flag: 1 = usa dias_ocupados, 0 = normal
@@ -177,7 +263,13 @@ int** aux_mov_r7;         // [disciplinas][2] - [0]=excesso, [1]=posição (R7)
 int* aux_mov_r8;          // Posições de violação de estabilidade (R8)
 int* aux_mov_r9;          // Guarda professores com aula em mais de três dias (R9)
 int** aux_mov_r10;        // [disciplinas][2] - [0]=tipo correto, [1]=posição (R7)
-int** aux_mov_r11;         // [total_periodos][salas] - Disciplinas isoladas (R6)
+
+// Representação por aula (cada aula exigida tem um ID fixo)
+int  total_aulas;         // Soma de disc[].aulas
+int* primeira_aula;       // [disciplinas] - ID da primeira aula da disciplina
+int* aula_disc;           // [total_aulas] - Disciplina de cada aula
+int* qtDiscProf;          // [professores] - Quantidade de disciplinas do professor
+int** discProf;           // [professores][qtDiscProf] - Disciplinas do professor
 
 
 // Parâmetros da instância
@@ -199,13 +291,66 @@ float Tfinal;             // Temperatura final (critério de parada)
 float alpha;              // Taxa de resfriamento (0 < alpha < 1)
 int maxIteracoes;         // Número de iterações por temperatura
 
+/*
+ * Parâmetros ajustáveis do SA e do geraViz (arquivo lido com -p, gerado
+ * pela corrida de parâmetros). Os valores iniciais são os originais.
+ */
+typedef struct parametrosSA{
+	float Tinicial;                   // Temperatura inicial
+	float Tfinal;                     // Temperatura final (critério de parada)
+	double limiar[NUM_FAIXAS_T - 1];  // Temperaturas que separam as faixas (decrescentes)
+	int   iteracoes[NUM_FAIXAS_T];    // Iterações por temperatura em cada faixa
+	float alpha[NUM_FAIXAS_T];        // Resfriamento em cada faixa
+	int   amplificacao;               // Delta amplificado em delta << amplificacao
+	int   estagnacao;                 // Passos de temperatura sem melhora até parar
+	int   faixa_viz[NUM_FAIXAS_VIZ];  // Limites das faixas de movimento do geraViz
+	int   janela;                     // Passos de temperatura da janela de estagnação
+	float aceitacao_minima;           // Taxa de aceitação abaixo da qual a janela estagnou
+	float aceitacao_reaquecimento;    // Chance de aceitar a piora mediana após reaquecer
+	int   tabu;                       // 1 = rejeita vizinhos iguais a estados aceitos recentes
+}ParametrosSA;
+
+ParametrosSA param = {
+	1000000, 0.00001,
+	{1000, 100, 10, 1, 0.1},
+	{600, 800, 1000, 1200, 1500, 1200},
+	{0.98, 0.97, 0.98, 0.99, 0.993, 0.995},
+	2, 8000,
+	{100, 200, 300, 400, 500, 600, 700, 800, 900},
+	50, 0.002, 0.3, 0
+};
+#ifdef VERIFICA_INVARIANTES
+int intervalo_verificacao = 1;  // Confere o delta contra calcula_FO a cada N iterações (0 = não)
+#else
+int intervalo_verificacao = 0;  // Confere o delta contra calcula_FO a cada N iterações (0 = não)
+#endif
+unsigned long long estado_rng = 0x853c49e6748fea9bULL;  // Estado do gerador aleatório
+double prazo_sa = 0;      // Segundos de relógio por execução do SA (0 = sem prazo)
+int parar_se_viavel = 0;  // 1 = o SA para na primeira grade sem violações graves
+int fase_final = 1;       // 0 = o SA termina sem religação e polimento (episódios de reinicios)
+float temperatura_partida = 0;  // Temperatura inicial do SA (0 = Tinicial)
+
+// Checkpoint e retomada
+int  retomar = 0;                                   // 1 = continua do checkpoint salvo
+int  intervalo_checkpoint = INTERVALO_CHECKPOINT;   // Passos de temperatura entre checkpoints (0 = desliga)
+char arquivo_checkpoint[SIZE * 2] = "";             // Checkpoint da grade em construção
+
+// Pedidos recebidos por sinal (ver SINAIS)
+atomic_int parar_busca = 0;                         // SIGINT/SIGTERM recebido
+atomic_int pedido_despejo = 0;                      // SIGUSR1 ainda não atendido
+char arquivo_despejo[SIZE * 2] = "";                // Destino do despejo da grade em construção
+
+// Arquivo sempre válido com a melhor solução (atualizado durante o SA)
+char   arquivo_incumbente[SIZE * 2] = "";                  // Melhor solução da grade em construção
+double intervalo_incumbente = INTERVALO_INCUMBENTE;        // Segundos entre gravações (0 = toda melhora)
+
 // ============================================================================
 // FUNÇÕES AUXILIARES BÁSICAS
 // ============================================================================
 
 /*
  * MODULO: Calcula o módulo da diferença entre dois números
- * Usado para calcular violações de R1 (diferença entre aulas agendadas e requeridas)
+ * Usado para conferir R1 (diferença entre aulas agendadas e requeridas)
  */
 int modulo(int n1, int n2){
 	if(n1 > n2) return n1 - n2;  // Se n1 maior, retorna n1 - n2
@@ -232,21 +377,46 @@ int numDisciplina(char *nome){
 int numProf(char *nome){
 	int i;
 	// Percorre todos os professores buscando o nome
-	for(i = 0; i < disciplinas; i++) 
+	for(i = 0; i < professores; i++) 
 		if(strcmp(nome, prof[i].nome) == 0) 
 			return i;  // Retorna o índice se encontrou
 	return -1;  // Retorna -1 se não encontrou
 }
 
+/*
+ * NUMSALA: Retorna o ID de uma sala dado seu nome
+ * Retorna -1 se não encontrada
+ */
+int numSala(char *nome){
+	int i;
+	// Percorre todas as salas buscando o nome
+	for(i = 0; i < salas; i++) 
+		if(strcmp(nome, sala[i].nome) == 0) 
+			return i;  // Retorna o índice se encontrou
+	return -1;  // Retorna -1 se não encontrou
+}
+
+/*
+ * ALEATORIO: Gerador xorshift64* com o estado em estado_rng
+ * Substitui rand(): o estado cabe no checkpoint e a retomada fica idêntica.
+ * Retorna um inteiro em [0, 2^31)
+ */
+int aleatorio(){
+	estado_rng ^= estado_rng >> 12;
+	estado_rng ^= estado_rng << 25;
+	estado_rng ^= estado_rng >> 27;
+	return (int)((estado_rng * 0x2545f4914f6cdd1dULL) >> 33);
+}
+
 /*
  * RANDOMDOUBLE: Gera número aleatório double no intervalo [inicio, fim)
  * Usado para o critério de Metropolis no SA
  */
 double randomDouble(double inicio, double fim){
-	// rand() % 10000 gera número de 0 a 9999
+	// aleatorio() % 10000 gera número de 0 a 9999
 	// Divide por 10000.0 para obter valor entre 0 e 1
 	// Multiplica pelo intervalo e soma ao início
-	return ((double) (rand() % 10000) / 10000.0) * (fim-inicio) + inicio;
+	return ((double) (aleatorio() % 10000) / 10000.0) * (fim-inicio) + inicio;
 }
 
 /*
@@ -258,6 +428,185 @@ int randomInt(int inicio, int fim){
 	return (int) randomDouble(0, fim - inicio + 1.0) + inicio;
 }
 
+/*
+ * RELOGIO: Segundos de um relógio monotônico (tempo real, não de CPU)
+ */
+double relogio(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ============================================================================
+// SONDAS DE TEMPO POR FUNÇÃO
+// ============================================================================
+
+/*
+ * Compilado com -DSONDAS, SONDA(id) no início de uma função mede o tempo
+ * até a saída do escopo (variável com __attribute__((cleanup)): vale para
+ * qualquer return) e conta as chamadas. O tempo é inclusivo: calcula_FO
+ * inclui as restricaoR4/R6 que chama.
+ * 
+ * Cada thread acumula numa tabela própria (__thread, sem trava e sem
+ * disputa de cache). Ao terminar, a thread soma a sua tabela ao total
+ * (destrutor da pthread_key) e relatorioSondas soma a da thread principal
+ * no fim da execução. Sem a opção, SONDA não gera código.
+ */
+#ifdef SONDAS
+
+/*
+ * SONDA: Tempo e chamadas acumulados de uma função
+ */
+typedef struct sonda{
+	unsigned long long ns;        // Tempo total (inclusivo)
+	unsigned long long chamadas;  // Quantidade de chamadas
+}Sonda;
+
+/*
+ * MEDICAO: Uma chamada em andamento (variável de escopo da SONDA)
+ */
+typedef struct medicao{
+	int id;
+	struct timespec inicio;
+}Medicao;
+
+__thread Sonda sondas_thread[NUM_SONDAS];    // Tabela da thread
+__thread int   sondas_registradas = 0;       // Tabela já ligada à chave
+Sonda sondas_total[NUM_SONDAS];              // Tabelas das threads encerradas
+int   sondas_threads = 0;                    // Threads somadas ao total
+pthread_mutex_t trava_sondas = PTHREAD_MUTEX_INITIALIZER;
+pthread_key_t   chave_sondas;
+pthread_once_t  sondas_uma_vez = PTHREAD_ONCE_INIT;
+const char *nome_sonda[NUM_SONDAS] = {"calcula_FO", "geraViz", "copiaMatriz", "restricaoR6", "restricaoR4"};
+
+/*
+ * MESCLASONDAS: Soma a tabela de uma thread ao total e a zera
+ */
+void mesclaSondas(void *tabela){
+	Sonda *s = (Sonda*) tabela;
+	int k;
+
+	pthread_mutex_lock(&trava_sondas);
+	for(k = 0; k < NUM_SONDAS; k++){
+		sondas_total[k].ns += s[k].ns;
+		sondas_total[k].chamadas += s[k].chamadas;
+	}
+	memset(s, 0, NUM_SONDAS * sizeof(Sonda));
+	sondas_threads++;
+	pthread_mutex_unlock(&trava_sondas);
+}
+
+void criaChaveSondas(){
+	pthread_key_create(&chave_sondas, mesclaSondas);
+}
+
+static inline void iniciaMedicao(Medicao *m, int id){
+	if(!sondas_registradas){
+		// Primeira sonda da thread: a tabela é somada quando ela terminar
+		pthread_once(&sondas_uma_vez, criaChaveSondas);
+		pthread_setspecific(chave_sondas, sondas_thread);
+		sondas_registradas = 1;
+	}
+	m->id = id;
+	clock_gettime(CLOCK_MONOTONIC, &m->inicio);
+}
+
+static inline void fimMedicao(Medicao *m){
+	struct timespec fim;
+
+	clock_gettime(CLOCK_MONOTONIC, &fim);
+	sondas_thread[m->id].ns += (fim.tv_sec - m->inicio.tv_sec) * 1000000000ULL + fim.tv_nsec - m->inicio.tv_nsec;
+	sondas_thread[m->id].chamadas++;
+}
+
+/*
+ * RELATORIOSONDAS: Soma a thread principal e exibe o total por função
+ */
+void relatorioSondas(FILE *fp){
+	int k;
+
+	mesclaSondas(sondas_thread);
+	fprintf(fp, "\n============ SONDAS DE TEMPO (%d threads) ============\n", sondas_threads);
+	fprintf(fp, "%-13s %14s %12s %12s\n", "Função", "Chamadas", "Total (ms)", "ns/chamada");  // "ç": 2 bytes
+	for(k = 0; k < NUM_SONDAS; k++)
+		fprintf(fp, "%-12s %14llu %12.1f %12.1f\n", nome_sonda[k], sondas_total[k].chamadas,
+		        sondas_total[k].ns / 1e6,
+		        sondas_total[k].chamadas ? (double) sondas_total[k].ns / sondas_total[k].chamadas : 0.0);
+	fprintf(fp, "=======================================================\n");
+}
+
+#define SONDA(id) Medicao __attribute__((cleanup(fimMedicao))) medicao_##id; iniciaMedicao(&medicao_##id, id)
+#else
+#define SONDA(id)
+#endif
+
+// ============================================================================
+// CARACTERÍSTICAS DA INSTÂNCIA
+// ============================================================================
+
+/*
+ * Vetor de características calculado na leitura, usado para escolher o
+ * perfil de parâmetros mais próximo (ver PERFIS DE PARÂMETROS):
+ * 0. Ocupação: aulas / (períodos x salas)
+ * 1. Escassez de tipo de sala: maior razão, entre os tipos exigidos, de
+ *    aulas que exigem o tipo t por horários de salas do tipo t
+ * 2. Densidade de conflitos: pares de disciplinas com professor ou
+ *    currículo em comum / pares possíveis
+ * 3. Indisponibilidade: restrições / (disciplinas x períodos)
+ */
+double caracteristicas[NUM_CARACTERISTICAS];
+const char *nome_caracteristica[NUM_CARACTERISTICAS] = {"ocupação", "escassez de tipo", "densidade de conflitos", "indisponibilidade"};
+
+/*
+ * CALCULACARACTERISTICAS: Preenche caracteristicas[] com a instância lida
+ */
+void calculaCaracteristicas(){
+	int i, j, k, c, d, t, vizinhos, demanda, oferta;
+	long long pares = 0;
+	int *marca = (int*) calloc(disciplinas + 1, sizeof(int));
+	double razao;
+
+	caracteristicas[0] = (double) total_aulas / ((double) total_periodos * salas);
+
+	// Escassez: cada tipo exigido só usa salas do mesmo tipo (R10)
+	caracteristicas[1] = 0;
+	for(i = 0; i < disciplinas; i++){
+		t = disc[i].tipo_sala;
+		for(j = 0; (j < i) && (disc[j].tipo_sala != t); j++);
+		if(j < i) continue;  // Tipo já avaliado
+
+		demanda = oferta = 0;
+		for(d = 0; d < disciplinas; d++)
+			if(disc[d].tipo_sala == t) demanda += disc[d].aulas;
+		for(k = 0; k < salas; k++)
+			if(sala[k].tipo_sala == t) oferta += total_periodos;
+		razao = (oferta > 0) ? (double) demanda / oferta : demanda;
+		if(razao > caracteristicas[1]) caracteristicas[1] = razao;
+	}
+
+	// Conflitos: vizinhos distintos de cada disciplina (marcados com d + 1)
+	for(d = 0; d < disciplinas; d++){
+		vizinhos = 0;
+		marca[d] = d + 1;
+		for(i = 0; i < qtDiscProf[disc[d].prof]; i++){
+			j = discProf[disc[d].prof][i];
+			if(marca[j] != d + 1){ marca[j] = d + 1; vizinhos++; }
+		}
+		for(k = 0; k < disc[d].qtCursos; k++){
+			c = disc[d].listaCursos[k];
+			for(i = 0; i < curso[c].qtDisc; i++){
+				j = curso[c].disciplina[i];
+				if((j >= 0) && (marca[j] != d + 1)){ marca[j] = d + 1; vizinhos++; }
+			}
+		}
+		pares += vizinhos;
+	}
+	caracteristicas[2] = (disciplinas > 1) ? pares / ((double) disciplinas * (disciplinas - 1)) : 0;
+
+	caracteristicas[3] = (double) restricoes / ((double) disciplinas * total_periodos);
+	free(marca);
+}
+
 // ============================================================================
 // LEITURA DO ARQUIVO DE ENTRADA
 // ============================================================================
@@ -278,6 +627,7 @@ int leArquivos(char *arquivo){
 	strcpy(nome, "");              // Inicializa variável de nome
 	FILE *fp;                      // Ponteiro para arquivo
 	int i, c, aux;                 // Contadores
+	int tam = 0;                   // Caracteres da linha no buffer
 	int tipo = 0;                  // Controla tipo de entrada sendo lida
 	char x[SIZE * SIZE];           // Buffer de leitura
 	char *lc;                      // Ponteiro para tokenização
@@ -290,6 +640,7 @@ int leArquivos(char *arquivo){
         // Libera sub-estruturas de disc
         for(i = 0; i < disciplinas; i++){
             free(disc[i].cursos);
+            free(disc[i].listaCursos);
         }
         free(disc);
         
@@ -311,12 +662,10 @@ int leArquivos(char *arquivo){
             free(r21[i]);
             free(r22[i]);
             free(aux_mov_r6[i]);
-            free(aux_mov_r11[i]);
         }
         free(r21);
         free(r22);
         free(aux_mov_r6);
-        free(aux_mov_r11);
         
         for(i = 0; i < disciplinas; i++){
             free(r5[i]);
@@ -329,8 +678,13 @@ int leArquivos(char *arquivo){
         
         for(i = 0; i < professores; i++){
             free(r9[i]);
+            free(discProf[i]);
         }
         free(r9);
+        free(discProf);
+        free(qtDiscProf);
+        free(primeira_aula);
+        free(aula_disc);
         
         for(i = 0; i < dias; i++){
             free(r11[i]);
@@ -344,10 +698,18 @@ int leArquivos(char *arquivo){
         free(aux_mov_r5);
         free(aux_mov_r8);
         free(aux_mov_r9);
-        free(r1);
         free(r8);
     }
 
+	// Contadores da nova instância (só depois de liberar as estruturas da antiga)
+	professores = 0;
+	disciplinas = 0;
+	salas = 0;
+	dias = 0;
+	periodos_dia = 0;
+	cursos = 0;
+	restricoes = 0;
+
 	// Tenta abrir o arquivo
 	fp = fopen(arquivo, "r");      // Modo leitura
 	if(!fp)	{
@@ -477,8 +839,10 @@ int leArquivos(char *arquivo){
 				}
 				// === TIPO 40: Lendo restrições ===
 				else if(tipo == 40){
-					if(c < restricoes){  // Ainda há restrições para ler
-						sscanf(x, "%s %d %d", char_aux, &restricao[c].dia, &restricao[c].per);
+					// Ainda há restrições para ler (e a linha é uma restrição)
+					if((c < restricoes) &&
+					   (sscanf(x, "%s %d %d", char_aux, &restricao[c].dia, &restricao[c].per) == 3) &&
+					   (numDisciplina(char_aux) != -1)){
 						restricao[c].disciplina = numDisciplina(char_aux);
 						
 						// Marca início da lista de restrições desta disciplina
@@ -489,7 +853,11 @@ int leArquivos(char *arquivo){
 						posicao_restricao[1][numDisciplina(char_aux)] = c;
 						c++;  // Próxima restrição
 					}
-					else{tipo = 0; c = 0;}  // Terminou, reseta tipo
+					else{
+						// Seção menor que o cabeçalho (instâncias Unifesp): valem as lidas
+						if(c < restricoes) restricoes = c;
+						tipo = 0; c = 0;  // Terminou, reseta tipo
+					}
 				}
 				// Identifica seções do arquivo
 				else if(strcmp(x, "COURSES:") == 0)	{tipo = 10; c = 0;}
@@ -498,8 +866,12 @@ int leArquivos(char *arquivo){
 				else if(strcmp(x, "UNAVAILABILITY_CONSTRAINTS:") == 0){	tipo = 40; c = 0;}
 				
 				strcpy(x, "");  // Limpa buffer para próxima linha
+				tam = 0;
+			}
+			else if(tam < SIZE * SIZE - 1){	// Acrescenta caractere na string
+				x[tam++] = (char)i;
+				x[tam] = '\0';
 			}
-			else sprintf(x, "%s%c", x, i); 	// Acrescenta caractere na string
 			
 			i = fgetc(fp);  // Lê próximo caractere
 		}
@@ -509,6 +881,15 @@ int leArquivos(char *arquivo){
 	// Calcula total de períodos
 	total_periodos = periodos_dia * dias;
 
+	// Lista compacta dos cursos de cada disciplina (evita varrer todos os cursos)
+	for(c = 0; c < disciplinas; c++){
+		disc[c].listaCursos = (int*) malloc((cursos + 1) * sizeof(int));
+		disc[c].qtCursos = 0;
+		for(i = 0; i < cursos; i++)
+			if(disc[c].cursos[i] == 1)
+				disc[c].listaCursos[disc[c].qtCursos++] = i;
+	}
+
 	// Vetores auxiliares para movimentos direcionados
 	aux_mov_r21 = (int*) malloc(disciplinas * sizeof(int));
 	aux_mov_r22 = (int*) malloc(disciplinas * sizeof(int));
@@ -519,11 +900,9 @@ int leArquivos(char *arquivo){
 	aux_mov_r8 = (int*) malloc(periodos_dia*dias * sizeof(int));
 	aux_mov_r9 = (int*) malloc(professores * sizeof(int));
 	aux_mov_r10 = (int**) malloc(disciplinas * sizeof(int *));
-	aux_mov_r11 = (int**) malloc(total_periodos * sizeof(int*));
 	
 
 	// Vetores de controle de restrições
-	r1 =  (int*) malloc(disciplinas * sizeof(int));
 	r21 = (int**) malloc(total_periodos * sizeof(int *));
 	r22 = (int**) malloc(total_periodos * sizeof(int *));
 	r5 = (int**) malloc(disciplinas * sizeof(int *));
@@ -548,9 +927,32 @@ int leArquivos(char *arquivo){
 	for(i = 0; i < dias; i++){
 		r11[i] = (int*) malloc(disciplinas * sizeof(int));
 	}
-	for(i = 0; i < total_periodos; i++){
-		aux_mov_r11[i] = (int*) malloc(salas * sizeof(int));
+
+	// IDs das aulas: as aulas da disciplina d são primeira_aula[d] .. + disc[d].aulas - 1
+	primeira_aula = (int*) malloc(disciplinas * sizeof(int));
+	total_aulas = 0;
+	for(c = 0; c < disciplinas; c++){
+		primeira_aula[c] = total_aulas;
+		total_aulas += disc[c].aulas;
 	}
+	aula_disc = (int*) malloc((total_aulas + 1) * sizeof(int));
+	for(c = 0; c < disciplinas; c++)
+		for(i = 0; i < disc[c].aulas; i++)
+			aula_disc[primeira_aula[c] + i] = c;
+
+	// Disciplinas de cada professor (acesso direto às aulas do professor)
+	qtDiscProf = (int*) calloc(professores, sizeof(int));
+	discProf = (int**) malloc(professores * sizeof(int*));
+	for(c = 0; c < disciplinas; c++)
+		qtDiscProf[disc[c].prof]++;
+	for(i = 0; i < professores; i++){
+		discProf[i] = (int*) malloc((qtDiscProf[i] + 1) * sizeof(int));
+		qtDiscProf[i] = 0;
+	}
+	for(c = 0; c < disciplinas; c++)
+		discProf[disc[c].prof][qtDiscProf[disc[c].prof]++] = c;
+
+	calculaCaracteristicas();  // Escolha do perfil de parâmetros
 	
 	return 1;  // Sucesso
 }
@@ -589,7 +991,7 @@ void imprimeSolucao(Matriz matriz){
 	}
 
 	// Exibe valor da função objetivo
-	printf("\n***FO = %d***\n", matriz.fo);
+	printf("\n***FO = %lld***\n", matriz.fo);
 }
 
 // ============================================================================
@@ -606,6 +1008,7 @@ int restricaoR4(int dis, int per){
 	int dia = per/periodos_dia;       // Extrai dia do período
 	int diaPer = per%periodos_dia;    // Extrai período do dia
 	int i;
+	SONDA(SONDA_R4);
 
 	// Se a disciplina não possui restrições
 	if(posicao_restricao[0][dis] == -1) 
@@ -632,6 +1035,7 @@ int restricaoR4(int dis, int per){
  */
 int restricaoR6(Matriz matriz, int dis, int per, int sal){
 	int i, j, penalidade, ok;
+	SONDA(SONDA_R6);
 
 	penalidade = 0;
 	
@@ -726,10 +1130,11 @@ int somaVetor(int *vetor, int tamanho){
  * Esta é a função mais importante do algoritmo, pois define
  * a qualidade de cada solução.
  */
-int calcula_FO(Matriz matriz){
-	int fo = 0;  // Inicializa função objetivo
+long long calcula_FO(Matriz matriz){
+	long long fo = 0;  // Inicializa função objetivo
 	int i, j, k;
-	int r5_aux, sub_r7;
+	int r5_aux, sub_r7, r6;
+	SONDA(SONDA_CALCULA_FO);
 
 	// ========================================================================
 	// INICIALIZAÇÃO: Zera todas as estruturas de controle
@@ -755,7 +1160,6 @@ int calcula_FO(Matriz matriz){
 	setMatriz(aux_mov_r6, total_periodos, salas, -1); // Zera auxiliar R6
 	setMatriz(aux_mov_r7, disciplinas, 2, -1);        // Zera auxiliar R7
 	setMatriz(aux_mov_r10, disciplinas, 2, -1);        // Zera auxiliar R10
-	setMatriz(aux_mov_r11, total_periodos, salas, -1);;// Zera auxiliar R11
 
 	setVetor(aux_mov_r21, disciplinas, -1);  // Zera auxiliar R2 (professor)
 	setVetor(aux_mov_r22, disciplinas, -1);  // Zera auxiliar R2 (curso)
@@ -763,9 +1167,10 @@ int calcula_FO(Matriz matriz){
 	setVetor(aux_mov_r5, disciplinas, -1);   // Zera auxiliar R5
 	setVetor(aux_mov_r8, total_periodos, -1); // Zera auxiliar R8
     setVetor(aux_mov_r9, professores, -1);   // Zera auxiliar R9
-	setVetor(r1, disciplinas, 0);            // Zera contagem de aulas (R1)
 	setVetor(r8, disciplinas, -1);           // Zera primeira sala (R8)
 	setVetor(restricoes_violadas, 12, -1);    // Zera contador de violações
+	for(k = 0; k < 12; k++)
+		penalidades[k] = 0;                   // Zera penalidades por restrição
 	setMatriz(r11, dias, disciplinas, 0);	  // Zera auxiliar R11
 
 	// ========================================================================
@@ -776,10 +1181,8 @@ int calcula_FO(Matriz matriz){
 		for(j = 0; j < salas; j++){           // Para cada sala
 			if(matriz.n[i][j] != -1){        // Se há aula alocada
 				
-				// ============================================================
-				// R1: Conta quantas vezes cada disciplina foi alocada
-				// ============================================================
-				r1[matriz.n[i][j]]++;
+				// R1 e R3 valem por construção: a grade tem uma aula por
+				// célula e os movimentos só trocam células (trocaCelulas)
 				
 				// ============================================================
 				// R2: Verifica conflitos de PROFESSOR
@@ -808,6 +1211,7 @@ int calcula_FO(Matriz matriz){
 					aux_mov_r4[matriz.n[i][j]] = (j * total_periodos) + i;  // Guarda posição
 					restricoes_violadas[4]++;
 					fo += 1000000;  // PENALIDADE GRAVE!
+					penalidades[4] += 1000000;
 				}
 				
 				// ============================================================
@@ -818,7 +1222,9 @@ int calcula_FO(Matriz matriz){
 				// ============================================================
 				// R6: Verifica compacidade (aulas adjacentes)
 				// ============================================================
-				fo += restricaoR6(matriz, matriz.n[i][j], i, j);
+				r6 = restricaoR6(matriz, matriz.n[i][j], i, j);
+				fo += r6;
+				penalidades[6] += r6;
 				
 				// ============================================================
 				// R7: Verifica capacidade da sala
@@ -826,6 +1232,7 @@ int calcula_FO(Matriz matriz){
 				sub_r7 = disc[matriz.n[i][j]].alunos - sala[j].capacidade;
 				if(sub_r7 > 0){  // Se há alunos além da capacidade
 					fo += sub_r7;  // Penaliza 1 ponto por aluno extra
+					penalidades[7] += sub_r7;
 					restricoes_violadas[7] += sub_r7;
 					// Guarda a pior violação de cada disciplina
 					if(aux_mov_r7[matriz.n[i][j]][0] < sub_r7){
@@ -841,6 +1248,7 @@ int calcula_FO(Matriz matriz){
 					r8[matriz.n[i][j]] = j;  // Primeira sala usada
 				else if(r8[matriz.n[i][j]] != j){  // Sala diferente da primeira
 					fo += 1;  // Penaliza 1 ponto
+					penalidades[8] += 1;
 					restricoes_violadas[8]++;
 					if(restricoes_violadas[8] < total_periodos)
 						aux_mov_r8[restricoes_violadas[8]] = (j * total_periodos) + i;
@@ -858,6 +1266,7 @@ int calcula_FO(Matriz matriz){
 				// ============================================================
 				if(disc[matriz.n[i][j]].tipo_sala != sala[j].tipo_sala){
 					fo += 1000000;  // Penalização grave 
+					penalidades[10] += 1000000;
 					restricoes_violadas[10]++;
 					// Guarda tipo correto e posição codificada
 					aux_mov_r10[matriz.n[i][j]][0] = disc[matriz.n[i][j]].tipo_sala;
@@ -868,9 +1277,6 @@ int calcula_FO(Matriz matriz){
 				// R11: Conta ocorrências da disciplina no dia
 				// ============================================================
 				r11[i/periodos_dia][matriz.n[i][j]]++;
-				if(r11[i/periodos_dia][matriz.n[i][j]] > 1){
-					aux_mov_r11[i][j] = matriz.n[i][j];  // Guarda disciplina e posição
-				}
 			}
 		}
 	}
@@ -887,6 +1293,7 @@ int calcula_FO(Matriz matriz){
 		for(j = 0; j < professores; j++){
 			if(r21[i][j] > 1){
 				fo += 1000000 * (r21[i][j] - 1);  // PENALIDADE GRAVE!
+				penalidades[2] += 1000000 * (r21[i][j] - 1);
 				// Marca tipo de conflito (< 1000 = professor)
 				if(restricoes_violadas[2] < 0) 
 					restricoes_violadas[2] = 1;
@@ -898,6 +1305,7 @@ int calcula_FO(Matriz matriz){
 		for(j = 0; j < cursos; j++){
 			if(r22[i][j] > 1){
 				fo += 1000000 * (r22[i][j] - 1);  // PENALIDADE GRAVE!
+				penalidades[2] += 1000000 * (r22[i][j] - 1);
 				// Marca tipo de conflito (>= 1000 = curso)
 				if(restricoes_violadas[2] < 0) 
 					restricoes_violadas[2] = 1000;
@@ -908,15 +1316,11 @@ int calcula_FO(Matriz matriz){
 	}
 	
 	// ============================================================
-	// R1, R5 e R9: Verifica aulas agendadas e dias mínimos
+	// R5: Verifica dias mínimos
 	// ============================================================
 	for(i = 0; i < disciplinas; i++){
 		r5_aux = 0;
 		
-		// R1: Verifica se número de aulas está correto
-		if(r1[i] != disc[i].aulas) 
-			fo += 1000000 * (modulo(r1[i], disc[i].aulas));  // PENALIDADE GRAVE!
-		
 		// R5: Conta em quantos dias diferentes a disciplina aparece
 		for(j = 0; j < dias; j++)
 			if(r5[i][j] > 0)
@@ -925,6 +1329,7 @@ int calcula_FO(Matriz matriz){
 		// Se não atingiu o mínimo de dias
 		if(r5_aux < disc[i].minDias){
 			fo += 5 * (disc[i].minDias - r5_aux);  // Penaliza 5 pontos por dia
+			penalidades[5] += 5 * (disc[i].minDias - r5_aux);
 			restricoes_violadas[5] += r5_aux;
 			aux_mov_r5[i] = r5_aux;
 		}
@@ -941,6 +1346,7 @@ int calcula_FO(Matriz matriz){
         // Se o professor tem aulas em mais de 2 dias
         if(dias_com_aula > 2){
             fo += 5 * (dias_com_aula - 2);  // Penaliza 5 pontos por dia extra
+            penalidades[9] += 5 * (dias_com_aula - 2);
             restricoes_violadas[9] += (dias_com_aula - 2);
             aux_mov_r9[i] = dias_com_aula;
         }
@@ -954,6 +1360,7 @@ int calcula_FO(Matriz matriz){
 			if(r11[i][j] > 1){
 				// Penaliza cada ocorrência extra
 				fo += 1000000 * (r11[i][j] - 1);
+				penalidades[11] += 1000000 * (r11[i][j] - 1);
 				restricoes_violadas[11] += (r11[i][j] - 1);
 			}
 		}
@@ -962,6 +1369,282 @@ int calcula_FO(Matriz matriz){
 	return fo;  // Retorna valor da função objetivo
 }
 
+// ============================================================================
+// VERIFICAÇÃO PRÉVIA DE VIABILIDADE E LIMITES INFERIORES
+// ============================================================================
+
+/*
+ * Limites de contagem e de emparelhamento que provam, antes da busca, que
+ * nenhuma grade zera as restrições graves:
+ * - tipo de sala (R10): aulas do tipo t > salas do tipo t × períodos
+ * - disponibilidade e distribuição (R4, R11): disciplina com mais aulas do
+ *   que dias com algum período disponível
+ * - conflitos (R2): professor ou curso com mais aulas do que períodos
+ * - emparelhamento: aulas × períodos disponíveis (R4), cada período com
+ *   capacidade 1 (professor, curso) ou igual às salas do tipo (R10)
+ */
+
+long long limite_grave = 0;      // Limite inferior das penalidades graves (FO)
+long long limite_leve = 0;       // Limite inferior das penalidades leves (FO)
+long long limite_inferior = 0;   // limite_grave + limite_leve: nenhuma grade tem FO menor
+int limite_valido = 1;     // 0 = uma grade ficou abaixo do limite: não para nele
+
+/*
+ * EMPARELHAMENTO: Grafo bipartido aulas × períodos (aresta = período sem R4)
+ */
+typedef struct emparelhamento{
+	int  nl;         // Quantidade de aulas
+	int* disc_aula;  // [nl] disciplina de cada aula
+	int  cap;        // Aulas que cabem em um período
+	int* ocup;       // [total_periodos] aulas no período
+	int* quem;       // [total_periodos * cap] aulas alocadas em cada período
+	int* visto;      // [total_periodos] carimbo da busca
+	int  carimbo;    // Marca da busca corrente
+}Emparelhamento;
+
+/*
+ * AUMENTAEMPARELHAMENTO: Caminho aumentante (Kuhn) a partir da aula l
+ * Retorna 1 se a aula foi encaixada (possivelmente realocando outras).
+ */
+int aumentaEmparelhamento(Emparelhamento *e, int l){
+	int p, k;
+
+	for(p = 0; p < total_periodos; p++){
+		if((e->visto[p] == e->carimbo) || (restricaoR4(e->disc_aula[l], p) == 1))
+			continue;
+		e->visto[p] = e->carimbo;
+		if(e->ocup[p] < e->cap){
+			e->quem[p * e->cap + e->ocup[p]++] = l;
+			return 1;
+		}
+		for(k = 0; k < e->ocup[p]; k++){
+			if(aumentaEmparelhamento(e, e->quem[p * e->cap + k])){
+				e->quem[p * e->cap + k] = l;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * EMPARELHAMENTOMAXIMO: Quantas aulas das disciplinas listadas cabem nos
+ * períodos disponíveis, com no máximo cap aulas por período
+ */
+int emparelhamentoMaximo(int *lista, int n, int cap){
+	Emparelhamento e;
+	int i, k, total = 0;
+
+	if(cap < 1) return 0;
+	e.nl = 0;
+	for(i = 0; i < n; i++)
+		e.nl += disc[lista[i]].aulas;
+	e.disc_aula = (int*) malloc((e.nl + 1) * sizeof(int));
+	e.nl = 0;
+	for(i = 0; i < n; i++)
+		for(k = 0; k < disc[lista[i]].aulas; k++)
+			e.disc_aula[e.nl++] = lista[i];
+	e.cap = cap;
+	e.ocup = (int*) calloc(total_periodos, sizeof(int));
+	e.quem = (int*) malloc(total_periodos * cap * sizeof(int));
+	e.visto = (int*) calloc(total_periodos, sizeof(int));
+	e.carimbo = 0;
+
+	for(i = 0; i < e.nl; i++){
+		e.carimbo++;
+		total += aumentaEmparelhamento(&e, i);
+	}
+
+	free(e.disc_aula);
+	free(e.ocup);
+	free(e.quem);
+	free(e.visto);
+	return total;
+}
+
+/*
+ * VERIFICAVIABILIDADE: Aplica os limites à instância carregada e exibe cada
+ * prova de inviabilidade encontrada. Retorna quantas foram encontradas.
+ * 
+ * Cada aula que sobra num limite viola ao menos uma restrição grave. Nas
+ * disciplinas, tipos e professores as aulas de cada membro são distintas e
+ * as faltas somam. Cursos compartilham disciplinas: só o excesso de aulas
+ * sobre os períodos (R2 do próprio curso) soma; o resto da falta pode ser a
+ * mesma violação de R4 em vários cursos e entra uma vez, pelo maior. Entre
+ * famílias uma mesma violação pode contar duas vezes, então limite_grave
+ * fica com a maior soma.
+ */
+int verificaViabilidade(){
+	int i, j, p, t, n, aulas, cap, dias_ok, falta, inviavel = 0, max_tipo = 0;
+	int soma_disc = 0, soma_tipo = 0, soma_prof = 0, soma_curso = 0, maior_r4_curso = 0;
+	int lista[disciplinas + 1];
+	clock_t inicio = clock();
+
+	for(i = 0; i < disciplinas; i++)
+		if(disc[i].tipo_sala > max_tipo) max_tipo = disc[i].tipo_sala;
+	for(j = 0; j < salas; j++)
+		if(sala[j].tipo_sala > max_tipo) max_tipo = sala[j].tipo_sala;
+
+	// Disciplina: dias com algum período disponível (R4 + R11)
+	for(i = 0; i < disciplinas; i++){
+		dias_ok = 0;
+		for(j = 0; j < dias; j++){
+			for(p = j * periodos_dia; p < (j + 1) * periodos_dia; p++){
+				if(restricaoR4(i, p) == 0){
+					dias_ok++;
+					break;
+				}
+			}
+		}
+		if(disc[i].aulas > dias_ok){
+			printf("Inviável: %s tem %d aulas e só %d dias disponíveis (R4/R11)\n",
+			       disc[i].nome, disc[i].aulas, dias_ok);
+			soma_disc += disc[i].aulas - dias_ok;
+			inviavel++;
+		}
+	}
+
+	// Tipo de sala (R10): contagem e emparelhamento por tipo
+	for(t = 0; t <= max_tipo; t++){
+		n = 0;
+		aulas = 0;
+		for(i = 0; i < disciplinas; i++){
+			if(disc[i].tipo_sala != t) continue;
+			lista[n++] = i;
+			aulas += disc[i].aulas;
+		}
+		if(n == 0) continue;
+		cap = 0;
+		for(j = 0; j < salas; j++)
+			if(sala[j].tipo_sala == t) cap++;
+		falta = aulas - emparelhamentoMaximo(lista, n, cap);
+		if(falta == 0) continue;
+		if(aulas > cap * total_periodos)
+			printf("Inviável: %d aulas do tipo de sala %d e só %d salas × %d períodos (R10)\n",
+			       aulas, t, cap, total_periodos);
+		else
+			printf("Inviável: %d aulas do tipo de sala %d não cabem nos períodos disponíveis (R4/R10)\n", falta, t);
+		soma_tipo += falta;
+		inviavel++;
+	}
+
+	// Professor (R2): contagem e emparelhamento com um período por aula
+	for(i = 0; i < professores; i++){
+		aulas = 0;
+		for(j = 0; j < qtDiscProf[i]; j++)
+			aulas += disc[discProf[i][j]].aulas;
+		falta = aulas - emparelhamentoMaximo(discProf[i], qtDiscProf[i], 1);
+		if(falta == 0) continue;
+		if(aulas > total_periodos)
+			printf("Inviável: professor %s tem %d aulas e %d períodos (R2)\n", prof[i].nome, aulas, total_periodos);
+		else
+			printf("Inviável: %d aulas do professor %s não cabem nos períodos disponíveis (R2/R4)\n", falta, prof[i].nome);
+		soma_prof += falta;
+		inviavel++;
+	}
+
+	// Curso (R2): idem
+	for(i = 0; i < cursos; i++){
+		aulas = 0;
+		for(j = 0; j < curso[i].qtDisc; j++)
+			aulas += disc[curso[i].disciplina[j]].aulas;
+		falta = aulas - emparelhamentoMaximo(curso[i].disciplina, curso[i].qtDisc, 1);
+		if(falta == 0) continue;
+		if(aulas > total_periodos)
+			printf("Inviável: curso %s tem %d aulas e %d períodos (R2)\n", curso[i].nome, aulas, total_periodos);
+		else
+			printf("Inviável: %d aulas do curso %s não cabem nos períodos disponíveis (R2/R4)\n", falta, curso[i].nome);
+		if(aulas > total_periodos){
+			soma_curso += aulas - total_periodos;  // Contagem: R2 deste curso
+			falta -= aulas - total_periodos;
+		}
+		if(falta > maior_r4_curso) maior_r4_curso = falta;  // Emparelhamento: R4 pode ser comum
+		inviavel++;
+	}
+	soma_curso += maior_r4_curso;
+
+	// Maior soma entre as famílias
+	falta = soma_disc;
+	if(soma_tipo > falta) falta = soma_tipo;
+	if(soma_prof > falta) falta = soma_prof;
+	if(soma_curso > falta) falta = soma_curso;
+	limite_grave = 1000000LL * falta;
+
+	printf("Verificação de viabilidade: %d prova(s) de inviabilidade em %.1f ms", 
+	       inviavel, (double)(clock() - inicio) * 1000.0 / CLOCKS_PER_SEC);
+	if(inviavel > 0)
+		printf(" (FO >= %lld)", limite_grave);
+	printf("\n");
+	return inviavel;
+}
+
+/*
+ * LIMITEINFERIOR: Limites das penalidades leves, calculados uma vez por
+ * instância e somados a limite_grave
+ * 
+ * - R7: cada aula paga ao menos o excesso de alunos sobre a maior sala.
+ *   Usa todas as salas, não só as do tipo: trocar R7 por R10 não pode
+ *   tornar o limite inválido.
+ * - R5: a disciplina aparece em no máximo min(aulas, dias) dias.
+ * - R9: os dias herdados da integral já contam para o professor.
+ * Os limites não dependem das restrições graves, por isso somam.
+ */
+long long limiteInferior(){
+	int i, j, maior = 0, dias_max, herdados;
+	long long r5 = 0, r7 = 0, r9 = 0;
+
+	for(j = 0; j < salas; j++)
+		if(sala[j].capacidade > maior) maior = sala[j].capacidade;
+
+	for(i = 0; i < disciplinas; i++){
+		if(disc[i].alunos > maior)
+			r7 += (long long)disc[i].aulas * (disc[i].alunos - maior);
+		dias_max = (disc[i].aulas < dias) ? disc[i].aulas : dias;
+		if(dias_max < disc[i].minDias)
+			r5 += 5 * (disc[i].minDias - dias_max);
+	}
+
+	if(usar_restricao_integral && (dias_ocupados_integral != NULL)){
+		for(i = 0; (i < professores) && (i < num_profs_da_integral); i++){
+			herdados = 0;
+			for(j = 0; j < dias; j++)
+				if(dias_ocupados_integral[i][j] > 0) herdados++;
+			if(herdados > 2)
+				r9 += 5 * (herdados - 2);
+		}
+	}
+
+	limite_leve = r5 + r7 + r9;
+	limite_inferior = limite_grave + limite_leve;
+	limite_valido = 1;
+	printf("Limite inferior: FO >= %lld (graves %lld, R5 %lld, R7 %lld, R9 %lld)\n",
+	       limite_inferior, limite_grave, r5, r7, r9);
+	return limite_inferior;
+}
+
+/*
+ * MAIORFO: Limite superior da FO de qualquer grade da instância
+ * 
+ * Cada aula causa no máximo uma violação grave de R2 (professor), R4, R10
+ * e R11 e uma de R2 por curso da disciplina; nas leves, paga no máximo
+ * todos os alunos (R7), uma troca de sala (R8) e 2 por curso (R6). R5 e R9
+ * somam no máximo 5 por dia mínimo e 5 por dia de cada professor.
+ * Informado no teste de escala (a FO é long long e não estoura).
+ */
+long long maiorFO(){
+	long long graves = 0, leves = 0;
+	int i, k, nc;
+
+	for(i = 0; i < disciplinas; i++){
+		for(k = 0, nc = 0; k < cursos; k++)
+			nc += disc[i].cursos[k];
+		graves += (long long)disc[i].aulas * (4 + nc);
+		leves += (long long)disc[i].aulas * (disc[i].alunos + 1 + 2 * nc) + 5 * disc[i].minDias;
+	}
+	leves += 5LL * dias * professores;
+	return graves * 1000000 + leves;
+}
+
 // ============================================================================
 // MANIPULAÇÃO DE SOLUÇÕES
 // ============================================================================
@@ -982,6 +1665,17 @@ Matriz criaMatriz(){
 		for(j = 0; j < salas; j++) 
 			matriz.n[i][j] = -1;
 	}
+	matriz.hash = 0;  // Grade vazia
+
+	// Representação dual: célula -> aula e aula -> célula
+	matriz.a = (int**) malloc(total_periodos * sizeof(int *));
+	for(i = 0; i < total_periodos; i++){
+		matriz.a[i] = (int*) malloc(salas * sizeof(int));
+		for(j = 0; j < salas; j++)
+			matriz.a[i][j] = -1;
+	}
+	matriz.pos = (int*) malloc((total_aulas + 1) * sizeof(int));
+	setVetor(matriz.pos, total_aulas, -1);  // Nenhuma aula alocada
 	return matriz;
 }
 
@@ -991,112 +1685,694 @@ Matriz criaMatriz(){
  */
 void copiaMatriz(Matriz *destino, Matriz origem){
 	int i, j;
+	SONDA(SONDA_COPIAMATRIZ);
 	// Copia célula por célula
 	for(i = 0; i < total_periodos; i++){
 		for(j = 0; j < salas; j++) 
 			destino->n[i][j] = origem.n[i][j];
+		memcpy(destino->a[i], origem.a[i], salas * sizeof(int));
 	}
+	memcpy(destino->pos, origem.pos, total_aulas * sizeof(int));
 	destino->fo = origem.fo;  // Copia FO
+	destino->hash = origem.hash;
+}
+
+/*
+ * LIBERAMATRIZ: Libera a memória de uma solução
+ */
+void liberaMatriz(Matriz matriz){
+	int i;
+	for(i = 0; i < total_periodos; i++){
+		free(matriz.n[i]);
+		free(matriz.a[i]);
+	}
+	free(matriz.n);
+	free(matriz.a);
+	free(matriz.pos);
 }
 
 // ============================================================================
-// GERAÇÃO DE VIZINHANÇA - MOVIMENTOS
+// HASH DE ZOBRIST E MEMÓRIA DE ESTADOS RECENTES (TABU)
 // ============================================================================
 
 /*
- * GERAVIZ: Gera uma solução vizinha através de movimentos
- * 
- * Esta é a FUNÇÃO MAIS COMPLEXA do código!
- * 
- * ESTRATÉGIA: Busca local adaptativa com múltiplos operadores
- * - Se há violações específicas, tenta corrigi-las (INTENSIFICAÇÃO)
- * - Caso contrário, faz movimentos aleatórios (DIVERSIFICAÇÃO)
- * 
- * OPERADORES DE VIZINHANÇA:
- * 1. Correção de conflitos de professor (R2)
- * 2. Correção de conflitos de curso (R2)
- * 3. Correção de compacidade (R6)
- * 4. Correção de capacidade (R7)
- * 5. Correção de estabilidade (R8)
- * 6. Troca aleatória no mesmo período
- * 7. Troca aleatória na mesma sala
- * 8. Troca totalmente aleatória
- * 
- * A escolha do operador é baseada em:
- * - Quais restrições estão sendo violadas
- * - Um sorteio aleatório ponderado
- * - A temperatura atual (T)
+ * A chave de (disciplina, período, sala) combina uma chave aleatória da
+ * disciplina com uma da célula: a memória é O(disciplinas + células) em vez
+ * de O(disciplinas × células). O hash da solução é o XOR das chaves das
+ * células ocupadas e cada troca o atualiza em O(1).
  */
-Matriz geraViz(Matriz matriz){
-	int i, j, k, l, d, busca;
-	int per, sal, aux, aux2, aux3, tentativas, movimento, dia, dia_destino;
+unsigned long long *zobrist_disc = NULL;   // [disciplinas] chave da disciplina
+unsigned long long *zobrist_cel = NULL;    // [total_periodos * salas] chave da célula
 
-	aux = -1;
-	
-	// ========================================================================
-	// Define número de tentativas baseado na temperatura
-	// ========================================================================
-	if(T < 1) tentativas = 6;
-	else if(T < 10) tentativas = 5;
-	else if(T < 100) tentativas = 4;
-	else if(T < 1000) tentativas = 3;
-	else tentativas = 2;
+/*
+ * MISTURA64: Embaralha os bits de um inteiro de 64 bits (splitmix64)
+ */
+unsigned long long mistura64(unsigned long long x){
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
 
-	// ========================================================================
-	// Escolhe tipo de movimento (0-1000)
-	// ========================================================================
-	movimento = randomInt(0, 1000);
-	
-	// ========================================================================
-	// MOVIMENTO 1: Correção de conflitos de PROFESSOR (R2)
-	// Faixa: 0-100 + bônus proporcional ao número de conflitos
-	// ========================================================================
-	if((restricoes_violadas[2] != -1) && (movimento < 100 + ((restricoes_violadas[2]%1000) << 7))){
-		if(restricoes_violadas[2] % 1000 > 1){
-			i = 0;
-			aux = -1;
-			while(aux == -1){
-				j = randomInt(0, disciplinas - 1);
-				if(aux_mov_r21[j] != -1) 
-					aux = j;
-				else if(aux_mov_r21[i] != -1) 
-					aux = i;
-				i++;
-			}
+/*
+ * INICIAZOBRIST: Sorteia as chaves da instância carregada
+ * Usa gerador próprio com semente fixa para não consumir o gerador do SA.
+ */
+void iniciaZobrist(){
+	int i;
+	unsigned long long semente = 0x9e3779b97f4a7c15ULL;
 
-			sal = aux_mov_r21[aux] / total_periodos;
-			per = aux_mov_r21[aux] - (sal * total_periodos);
-			aux2 = -2;
-			
-			while(aux2 == -2){
-				k = randomInt(0, total_periodos - 1);
-				l = randomInt(0, salas - 1);
-				
-				if(matriz.n[k][l] == -1){
-					aux2 = matriz.n[per][sal];
-					matriz.n[per][sal] = -1;
-					matriz.n[k][l] = aux2;
-				}
-				else if(r21[k][disc[matriz.n[k][l]].prof] == 0){
-					aux2 = matriz.n[k][l];
-					matriz.n[k][l] = matriz.n[per][sal];
-					matriz.n[per][sal] = aux2;
-				}
-			}
-			aux_mov_r21[aux] = -1;
-			restricoes_violadas[2]--;
-		}
-		else{
-			aux = randomInt(1, tentativas);
-			while(aux > 0){
+	free(zobrist_disc);
+	free(zobrist_cel);
+	zobrist_disc = (unsigned long long*) malloc(disciplinas * sizeof(unsigned long long));
+	zobrist_cel = (unsigned long long*) malloc(total_periodos * salas * sizeof(unsigned long long));
+
+	for(i = 0; i < disciplinas; i++){
+		semente += 0x9e3779b97f4a7c15ULL;
+		zobrist_disc[i] = mistura64(semente);
+	}
+	for(i = 0; i < total_periodos * salas; i++){
+		semente += 0x9e3779b97f4a7c15ULL;
+		zobrist_cel[i] = mistura64(semente);
+	}
+}
+
+/*
+ * CHAVEZOBRIST: Chave da disciplina dis na célula (per, sal); 0 se vazia
+ */
+unsigned long long chaveZobrist(int dis, int per, int sal){
+	if(dis == -1) return 0;
+	return mistura64(zobrist_disc[dis] ^ zobrist_cel[per * salas + sal]);
+}
+
+/*
+ * CALCULAHASH: Calcula do zero o hash de uma solução
+ */
+unsigned long long calculaHash(Matriz matriz){
+	int i, j;
+	unsigned long long h = 0;
+
+	for(i = 0; i < total_periodos; i++)
+		for(j = 0; j < salas; j++)
+			h ^= chaveZobrist(matriz.n[i][j], i, j);
+	return h;
+}
+
+/*
+ * COLOCAAULA: Aloca a aula (ID) numa célula vazia, mantendo n, a, pos e hash
+ */
+void colocaAula(Matriz *matriz, int per, int sal, int aula){
+	int dis = aula_disc[aula];
+
+	matriz->n[per][sal] = dis;
+	matriz->a[per][sal] = aula;
+	matriz->pos[aula] = per * salas + sal;
+	matriz->hash ^= chaveZobrist(dis, per, sal);
+}
+
+/*
+ * TROCACELULAS: Troca o conteúdo de duas células e atualiza o hash em O(1)
+ * Todo movimento passa por aqui (mover para célula vazia é trocar com -1).
+ */
+void trocaCelulas(Matriz *matriz, int p1, int s1, int p2, int s2){
+	int a = matriz->n[p1][s1];
+	int b = matriz->n[p2][s2];
+	int la, lb;
+
+	if(a == b) return;  // Mesma célula, duas vazias ou mesma disciplina
+
+	matriz->hash ^= chaveZobrist(a, p1, s1) ^ chaveZobrist(b, p2, s2) ^
+	                chaveZobrist(b, p1, s1) ^ chaveZobrist(a, p2, s2);
+	matriz->n[p1][s1] = b;
+	matriz->n[p2][s2] = a;
+
+	// Mantém a representação por aula
+	la = matriz->a[p1][s1];
+	lb = matriz->a[p2][s2];
+	matriz->a[p1][s1] = lb;
+	matriz->a[p2][s2] = la;
+	if(la != -1) matriz->pos[la] = p2 * salas + s2;
+	if(lb != -1) matriz->pos[lb] = p1 * salas + s1;
+}
+
+/*
+ * TABU: Memória dos últimos estados aceitos pelo SA
+ * - recentes: anel com os hashes, na ordem em que foram aceitos
+ * - tab_hash/tab_cont: tabela hash (sondagem linear) com quantas vezes
+ *   cada hash está no anel, para consulta em O(1)
+ * Mesmo com o tabu desligado a memória conta as revisitas (ciclos).
+ */
+typedef struct tabu{
+	int duracao;                   // Quantos estados recentes são lembrados
+	unsigned long long *recentes;  // [duracao] anel de hashes
+	int pos;                       // Próxima posição do anel
+	int ocupados;                  // Posições preenchidas do anel
+	unsigned long long *tab_hash;  // [mascara + 1] hashes da tabela
+	int *tab_cont;                 // [mascara + 1] ocorrências no anel
+	int mascara;                   // Tamanho da tabela - 1 (potência de 2)
+	int remocoes;                  // Remoções desde a última reconstrução
+	long revisitas;                // Vizinhos que repetiram um estado recente
+	long proibidos;                // Vizinhos rejeitados pelo tabu
+}Tabu;
+
+/*
+ * CRIATABU: Aloca a memória para os últimos `duracao` estados
+ */
+Tabu* criaTabu(int duracao){
+	Tabu *t = (Tabu*) malloc(sizeof(Tabu));
+	int tamanho = 1;
+
+	while(tamanho < 4 * duracao) tamanho <<= 1;
+	t->duracao = duracao;
+	t->recentes = (unsigned long long*) malloc(duracao * sizeof(unsigned long long));
+	t->tab_hash = (unsigned long long*) calloc(tamanho, sizeof(unsigned long long));
+	t->tab_cont = (int*) calloc(tamanho, sizeof(int));
+	t->mascara = tamanho - 1;
+	t->pos = 0;
+	t->ocupados = 0;
+	t->remocoes = 0;
+	t->revisitas = 0;
+	t->proibidos = 0;
+	return t;
+}
+
+/*
+ * LIBERATABU: Libera a memória de estados recentes
+ */
+void liberaTabu(Tabu *t){
+	free(t->recentes);
+	free(t->tab_hash);
+	free(t->tab_cont);
+	free(t);
+}
+
+/*
+ * POSICAOTABU: Posição do hash h na tabela (ou da célula livre onde entraria)
+ * Células com contagem zero e hash diferente de zero são "lápides": a busca
+ * continua por elas, mas podem ser reaproveitadas na inserção.
+ */
+int posicaoTabu(Tabu *t, unsigned long long h){
+	int i = (int)(h & t->mascara);
+	int livre = -1;
+
+	while((t->tab_hash[i] != 0) || (t->tab_cont[i] != 0)){
+		if(t->tab_hash[i] == h) return i;
+		if((t->tab_cont[i] == 0) && (livre == -1)) livre = i;
+		i = (i + 1) & t->mascara;
+	}
+	return (livre != -1) ? livre : i;
+}
+
+/*
+ * ESTADORECENTE: Retorna 1 se o hash está entre os últimos estados aceitos
+ */
+int estadoRecente(Tabu *t, unsigned long long h){
+	int i = posicaoTabu(t, h);
+	return (t->tab_hash[i] == h) && (t->tab_cont[i] > 0);
+}
+
+/*
+ * REGISTRAESTADO: Guarda o hash de um estado aceito, esquecendo o mais antigo
+ */
+void registraEstado(Tabu *t, unsigned long long h){
+	int i;
+
+	// Esquece o estado que sai do anel
+	if(t->ocupados == t->duracao){
+		t->tab_cont[posicaoTabu(t, t->recentes[t->pos])]--;
+		t->remocoes++;
+	}
+	else t->ocupados++;
+
+	t->recentes[t->pos] = h;
+	t->pos = (t->pos + 1) % t->duracao;
+
+	i = posicaoTabu(t, h);
+	t->tab_hash[i] = h;
+	t->tab_cont[i]++;
+
+	// Muitas lápides deixam a busca lenta: reconstrói a tabela a partir do anel
+	if(t->remocoes >= t->duracao){
+		setVetor(t->tab_cont, t->mascara + 1, 0);
+		memset(t->tab_hash, 0, (t->mascara + 1) * sizeof(unsigned long long));
+		for(i = 0; i < t->ocupados; i++){
+			int k = posicaoTabu(t, t->recentes[i]);
+			t->tab_hash[k] = t->recentes[i];
+			t->tab_cont[k]++;
+		}
+		t->remocoes = 0;
+	}
+}
+
+// ============================================================================
+// INVARIANTES DOS MOVIMENTOS (R1 E R3)
+// ============================================================================
+
+/*
+ * A solução só é montada por colocaAula (em células vazias, uma vez por
+ * aula) e depois só muda por trocaCelulas, que permuta o conteúdo de duas
+ * células. Assim nenhuma aula some ou se duplica (R1) e cada célula guarda
+ * no máximo uma aula (R3): calcula_FO e o avaliador não recontam isso.
+ * 
+ * Compilando com -DVERIFICA_INVARIANTES o SA confere as invariantes em cada
+ * vizinho gerado e na solução polida, e interrompe na primeira violação.
+ */
+
+/*
+ * VERIFICAINVARIANTES: Confere R1, R3, a representação por aula e o hash
+ * Retorna o número de inconsistências encontradas (0 = tudo certo).
+ */
+int verificaInvariantes(Matriz matriz, char *onde){
+	int i, j, a, erros = 0;
+	int cont[disciplinas + 1];
+
+	setVetor(cont, disciplinas, 0);
+	for(i = 0; i < total_periodos; i++){
+		for(j = 0; j < salas; j++){
+			a = matriz.a[i][j];
+			// R3: a célula e a aula têm que concordar (uma aula por célula)
+			if(a == -1){
+				if(matriz.n[i][j] != -1) erros++;
+				continue;
+			}
+			if((aula_disc[a] != matriz.n[i][j]) || (matriz.pos[a] != i * salas + j))
+				erros++;
+			cont[matriz.n[i][j]]++;
+		}
+	}
+	// R1: cada disciplina com exatamente disc[].aulas aulas na grade
+	for(i = 0; i < disciplinas; i++)
+		erros += modulo(cont[i], disc[i].aulas);
+	if(matriz.hash != calculaHash(matriz))
+		erros++;
+
+	if(erros > 0)
+		printf("\n*** INVARIANTE VIOLADA (%s): %d inconsistência(s) ***\n", onde, erros);
+	return erros;
+}
+
+// ============================================================================
+// AVALIAÇÃO INCREMENTAL (DELTA)
+// ============================================================================
+
+/*
+ * AVALIADOR: Área de trabalho para avaliar um movimento sem recalcular a FO
+ * 
+ * A FO é separável: R2, R4, R7 e R10 dependem só do período; R6 do período
+ * e dos vizinhos no mesmo dia; R1, R5, R8 e R11 só da disciplina; R9 só do
+ * professor. O movimento marca as células que vai alterar e o avaliador
+ * soma apenas as parcelas desses períodos, disciplinas e professores,
+ * antes e depois de aplicá-lo. As parcelas por disciplina e professor vêm
+ * da lista de aulas (matriz.pos), sem varrer a grade.
+ * 
+ * Os vetores são reaproveitados entre chamadas: cada thread usa o seu.
+ */
+typedef struct avaliador{
+	int  carimbo;        // Marca do movimento corrente (evita zerar vetores)
+	int  carimbo_r6;     // Marca da chamada corrente de custoParcial
+	int  carimbo_curso;  // Marca da chamada corrente de custoR6Periodo
+	int* marca_per;      // [total_periodos] período alterado pelo movimento
+	int* marca_r6;       // [total_periodos] período com R6 já somada
+	int* marca_disc;     // [disciplinas] disciplina afetada
+	int* marca_prof;     // [professores] professor afetado
+	int* marca_curso;    // [cursos] curso presente nos períodos vizinhos (R6)
+	int* lista_per;      // Períodos alterados
+	int* lista_disc;     // Disciplinas afetadas
+	int* lista_prof;     // Professores afetados
+	int  np, nd, nprof;  // Tamanho das listas
+	int* cont_prof;      // [professores] aulas no período (R2)
+	int* cont_curso;     // [cursos] aulas no período (R2)
+	int* cont_dia;       // [dias] aulas por dia (R5, R11) ou dias com aula (R9)
+	long long antes;             // Custo parcial antes do movimento
+	long long termos_antes[12];  // Parcelas por restrição antes do movimento
+	long long delta[12];         // Delta por restrição do último movimento
+	int  mov_tipo;       // Último movimento composto (-1 = nenhum; ver descreveMovimento)
+	int  mov_arg[3];     // Parâmetros do último movimento composto
+}Avaliador;
+
+/*
+ * CRIAAVALIADOR: Aloca a área de trabalho da avaliação incremental
+ */
+Avaliador* criaAvaliador(){
+	Avaliador *av = (Avaliador*) malloc(sizeof(Avaliador));
+
+	av->marca_per  = (int*) calloc(total_periodos, sizeof(int));
+	av->marca_r6   = (int*) calloc(total_periodos, sizeof(int));
+	av->marca_disc = (int*) calloc(disciplinas, sizeof(int));
+	av->marca_prof = (int*) calloc(professores, sizeof(int));
+	av->marca_curso = (int*) calloc(cursos, sizeof(int));
+	av->lista_per  = (int*) malloc(total_periodos * sizeof(int));
+	av->lista_disc = (int*) malloc(disciplinas * sizeof(int));
+	av->lista_prof = (int*) malloc(professores * sizeof(int));
+	av->cont_prof  = (int*) calloc(professores, sizeof(int));
+	av->cont_curso = (int*) calloc(cursos, sizeof(int));
+	av->cont_dia   = (int*) malloc(dias * sizeof(int));
+	av->carimbo = 0;
+	av->carimbo_r6 = 0;
+	av->carimbo_curso = 0;
+	av->np = av->nd = av->nprof = 0;
+	return av;
+}
+
+/*
+ * LIBERAAVALIADOR: Libera a área de trabalho da avaliação incremental
+ */
+void liberaAvaliador(Avaliador *av){
+	free(av->marca_per);
+	free(av->marca_r6);
+	free(av->marca_disc);
+	free(av->marca_prof);
+	free(av->marca_curso);
+	free(av->lista_per);
+	free(av->lista_disc);
+	free(av->lista_prof);
+	free(av->cont_prof);
+	free(av->cont_curso);
+	free(av->cont_dia);
+	free(av);
+}
+
+/*
+ * INICIAMOVIMENTO: Esvazia os conjuntos de períodos/disciplinas/professores
+ * afetados. Deve ser chamada antes de marcar as células de um movimento.
+ */
+void iniciaMovimento(Avaliador *av){
+	av->np = av->nd = av->nprof = 0;
+	av->carimbo++;
+	// Carimbo estourou: zera as marcas e recomeça
+	if(av->carimbo == 0x7fffffff){
+		setVetor(av->marca_per, total_periodos, 0);
+		setVetor(av->marca_disc, disciplinas, 0);
+		setVetor(av->marca_prof, professores, 0);
+		av->carimbo = 1;
+	}
+}
+
+/*
+ * MARCACELULA: Registra uma célula cujo conteúdo o movimento vai alterar
+ * Deve ser chamada ANTES do movimento, para capturar a disciplina atual.
+ * Movimentos só permutam conteúdos entre células marcadas, então o conjunto
+ * de disciplinas afetadas é o mesmo antes e depois.
+ */
+void marcaCelula(Avaliador *av, Matriz matriz, int per, int sal){
+	int dis = matriz.n[per][sal];
+
+	if(av->marca_per[per] != av->carimbo){
+		av->marca_per[per] = av->carimbo;
+		av->lista_per[av->np++] = per;
+	}
+	if(dis == -1) return;
+	if(av->marca_disc[dis] != av->carimbo){
+		av->marca_disc[dis] = av->carimbo;
+		av->lista_disc[av->nd++] = dis;
+	}
+	if(av->marca_prof[disc[dis].prof] != av->carimbo){
+		av->marca_prof[disc[dis].prof] = av->carimbo;
+		av->lista_prof[av->nprof++] = disc[dis].prof;
+	}
+}
+
+/*
+ * CUSTOR6PERIODO: Penalidade de compacidade das aulas de um período
+ * (mesma regra de restricaoR6, sem alterar as estruturas globais)
+ * 
+ * Marca os cursos presentes nos períodos vizinhos do mesmo dia e cobra 2
+ * pontos por curso de cada aula que não aparece em nenhum deles.
+ */
+int custoR6Periodo(Avaliador *av, Matriz matriz, int per){
+	int i, j, k, q, dis, penalidade = 0;
+
+	av->carimbo_curso++;
+	if(av->carimbo_curso == 0x7fffffff){
+		setVetor(av->marca_curso, cursos, 0);
+		av->carimbo_curso = 1;
+	}
+
+	// Cursos do período ANTERIOR e do SEGUINTE (dentro do mesmo dia)
+	for(q = per - 1; q <= per + 1; q += 2){
+		if((q < 0) || (q >= total_periodos) || (q / periodos_dia != per / periodos_dia))
+			continue;
+		for(j = 0; j < salas; j++){
+			dis = matriz.n[q][j];
+			if(dis == -1) continue;
+			for(k = 0; k < disc[dis].qtCursos; k++)
+				av->marca_curso[disc[dis].listaCursos[k]] = av->carimbo_curso;
+		}
+	}
+
+	for(j = 0; j < salas; j++){
+		dis = matriz.n[per][j];
+		if(dis == -1) continue;
+		for(i = 0; i < disc[dis].qtCursos; i++)
+			if(av->marca_curso[disc[dis].listaCursos[i]] != av->carimbo_curso)
+				penalidade += 2;
+	}
+	return penalidade;
+}
+
+/*
+ * CUSTOPARCIAL: Soma as parcelas da FO dos períodos, disciplinas e
+ * professores marcados. Preenche termos[] com a parcela de cada restrição.
+ */
+long long custoParcial(Avaliador *av, Matriz matriz, long long termos[12]){
+	int i, j, k, p, q, c, d, dis, pr, sub_r7, cont, prim;
+	long long total = 0;
+
+	for(k = 0; k < 12; k++)
+		termos[k] = 0;
+
+	// ------------------------------------------------------------------
+	// Períodos alterados: R2, R4, R7 e R10
+	// ------------------------------------------------------------------
+	for(i = 0; i < av->np; i++){
+		p = av->lista_per[i];
+		for(j = 0; j < salas; j++){
+			dis = matriz.n[p][j];
+			if(dis == -1) continue;
+
+			if(++av->cont_prof[disc[dis].prof] > 1)
+				termos[2] += 1000000;
+			for(k = 0; k < disc[dis].qtCursos; k++)
+				if(++av->cont_curso[disc[dis].listaCursos[k]] > 1)
+					termos[2] += 1000000;
+
+			if(restricaoR4(dis, p) == 1)
+				termos[4] += 1000000;
+
+			sub_r7 = disc[dis].alunos - sala[j].capacidade;
+			if(sub_r7 > 0)
+				termos[7] += sub_r7;
+
+			if(disc[dis].tipo_sala != sala[j].tipo_sala)
+				termos[10] += 1000000;
+		}
+		// Desfaz as contagens do período
+		for(j = 0; j < salas; j++){
+			dis = matriz.n[p][j];
+			if(dis == -1) continue;
+			av->cont_prof[disc[dis].prof] = 0;
+			for(k = 0; k < disc[dis].qtCursos; k++)
+				av->cont_curso[disc[dis].listaCursos[k]] = 0;
+		}
+	}
+
+	// ------------------------------------------------------------------
+	// R6: períodos alterados e seus vizinhos no mesmo dia
+	// ------------------------------------------------------------------
+	av->carimbo_r6++;
+	if(av->carimbo_r6 == 0x7fffffff){
+		setVetor(av->marca_r6, total_periodos, 0);
+		av->carimbo_r6 = 1;
+	}
+	for(i = 0; i < av->np; i++){
+		p = av->lista_per[i];
+		for(q = p - 1; q <= p + 1; q++){
+			if((q < 0) || (q >= total_periodos) || (q / periodos_dia != p / periodos_dia))
+				continue;
+			if(av->marca_r6[q] == av->carimbo_r6)
+				continue;
+			av->marca_r6[q] = av->carimbo_r6;
+			termos[6] += custoR6Periodo(av, matriz, q);
+		}
+	}
+
+	// ------------------------------------------------------------------
+	// Disciplinas (R5, R8, R11) e professores (R9): pela lista de aulas
+	// R1 vale por construção (toda aula tem exatamente uma célula)
+	// ------------------------------------------------------------------
+	for(i = 0; i < av->nd; i++){
+		d = av->lista_disc[i];
+		setVetor(av->cont_dia, dias, 0);
+
+		// Primeira sala da R8 = sala da aula com menor célula (ordem período/sala)
+		prim = -1;
+		for(k = primeira_aula[d]; k < primeira_aula[d] + disc[d].aulas; k++){
+			c = matriz.pos[k];
+			av->cont_dia[(c / salas) / periodos_dia]++;
+			if((prim == -1) || (c < prim))
+				prim = c;
+		}
+		for(k = primeira_aula[d]; k < primeira_aula[d] + disc[d].aulas; k++)
+			if(matriz.pos[k] % salas != prim % salas)
+				termos[8]++;
+
+		cont = 0;
+		for(j = 0; j < dias; j++){
+			if(av->cont_dia[j] > 0)
+				cont++;
+			if(av->cont_dia[j] > 1)
+				termos[11] += 1000000 * (av->cont_dia[j] - 1);
+		}
+		if(cont < disc[d].minDias)
+			termos[5] += 5 * (disc[d].minDias - cont);
+	}
+	for(i = 0; i < av->nprof; i++){
+		pr = av->lista_prof[i];
+		for(j = 0; j < dias; j++){
+			// Dias herdados da grade integral contam como ocupados
+			if(usar_restricao_integral && (dias_ocupados_integral != NULL) && (pr < num_profs_da_integral))
+				av->cont_dia[j] = dias_ocupados_integral[pr][j];
+			else
+				av->cont_dia[j] = 0;
+		}
+		for(q = 0; q < qtDiscProf[pr]; q++){
+			d = discProf[pr][q];
+			for(k = primeira_aula[d]; k < primeira_aula[d] + disc[d].aulas; k++)
+				av->cont_dia[(matriz.pos[k] / salas) / periodos_dia] = 1;
+		}
+		cont = 0;
+		for(j = 0; j < dias; j++)
+			if(av->cont_dia[j] > 0)
+				cont++;
+		if(cont > 2)
+			termos[9] += 5 * (cont - 2);
+	}
+
+	for(k = 0; k < 12; k++)
+		total += termos[k];
+	return total;
+}
+
+/*
+ * AVALIAANTES: Guarda o custo parcial das células marcadas antes do movimento
+ */
+void avaliaAntes(Avaliador *av, Matriz matriz){
+	av->antes = custoParcial(av, matriz, av->termos_antes);
+}
+
+/*
+ * AVALIADEPOIS: Calcula o custo parcial após o movimento
+ * Retorna o delta da FO e deixa o delta por restrição em av->delta[]
+ */
+long long avaliaDepois(Avaliador *av, Matriz matriz){
+	int k;
+	long long depois, termos[12];
+
+	depois = custoParcial(av, matriz, termos);
+	for(k = 0; k < 12; k++)
+		av->delta[k] = termos[k] - av->termos_antes[k];
+	return depois - av->antes;
+}
+
+// ============================================================================
+// GERAÇÃO DE VIZINHANÇA - MOVIMENTOS
+// ============================================================================
+
+/*
+ * GERAVIZ: Gera uma solução vizinha através de movimentos
+ * 
+ * Esta é a FUNÇÃO MAIS COMPLEXA do código!
+ * 
+ * ESTRATÉGIA: Busca local adaptativa com múltiplos operadores
+ * - Se há violações específicas, tenta corrigi-las (INTENSIFICAÇÃO)
+ * - Caso contrário, faz movimentos aleatórios (DIVERSIFICAÇÃO)
+ * 
+ * OPERADORES DE VIZINHANÇA:
+ * 1. Correção de conflitos de professor (R2)
+ * 2. Correção de conflitos de curso (R2)
+ * 3. Correção de compacidade (R6)
+ * 4. Correção de capacidade (R7)
+ * 5. Correção de estabilidade (R8)
+ * 6. Troca aleatória no mesmo período
+ * 7. Troca aleatória na mesma sala
+ * 8. Troca totalmente aleatória
+ * 
+ * A escolha do operador é baseada em:
+ * - Quais restrições estão sendo violadas
+ * - Um sorteio aleatório ponderado (faixas em param.faixa_viz; as faixas
+ *   citadas abaixo são os valores padrão)
+ * - A temperatura atual (T)
+ */
+Matriz geraViz(Matriz matriz){
+	int i, j, k, l, d, busca;
+	int per, sal, aux, aux2, aux3, tentativas, movimento, dia, dia_destino;
+	SONDA(SONDA_GERAVIZ);
+
+	aux = -1;
+	
+	// ========================================================================
+	// Define número de tentativas baseado na temperatura
+	// ========================================================================
+	if(T < 1) tentativas = 6;
+	else if(T < 10) tentativas = 5;
+	else if(T < 100) tentativas = 4;
+	else if(T < 1000) tentativas = 3;
+	else tentativas = 2;
+
+	// ========================================================================
+	// Escolhe tipo de movimento (0-1000)
+	// ========================================================================
+	movimento = randomInt(0, 1000);
+	
+	// ========================================================================
+	// MOVIMENTO 1: Correção de conflitos de PROFESSOR (R2)
+	// Faixa: 0-100 + bônus proporcional ao número de conflitos
+	// ========================================================================
+	if((restricoes_violadas[2] != -1) && (movimento < param.faixa_viz[0] + ((restricoes_violadas[2]%1000) << 7))){
+		if(restricoes_violadas[2] % 1000 > 1){
+			i = 0;
+			aux = -1;
+			while(aux == -1){
+				j = randomInt(0, disciplinas - 1);
+				if(aux_mov_r21[j] != -1) 
+					aux = j;
+				else if(aux_mov_r21[i] != -1) 
+					aux = i;
+				i++;
+			}
+
+			sal = aux_mov_r21[aux] / total_periodos;
+			per = aux_mov_r21[aux] - (sal * total_periodos);
+			aux2 = -2;
+			
+			while(aux2 == -2){
+				k = randomInt(0, total_periodos - 1);
+				l = randomInt(0, salas - 1);
+				
+				if(matriz.n[k][l] == -1){
+					aux2 = matriz.n[per][sal];
+					trocaCelulas(&matriz, per, sal, k, l);
+				}
+				else if(r21[k][disc[matriz.n[k][l]].prof] == 0){
+					aux2 = matriz.n[k][l];
+					trocaCelulas(&matriz, k, l, per, sal);
+				}
+			}
+			aux_mov_r21[aux] = -1;
+			restricoes_violadas[2]--;
+		}
+		else{
+			aux = randomInt(1, tentativas);
+			while(aux > 0){
 				i = randomInt(0, total_periodos - 1);
 				j = randomInt(0, salas - 1);
 				k = randomInt(0, total_periodos - 1);
 				l = randomInt(0, salas - 1);
 				if((matriz.n[i][j] != -1) || (matriz.n[k][l] != -1)){
 					aux2 = matriz.n[i][j];
-					matriz.n[i][j] = matriz.n[k][l];
-					matriz.n[k][l] = aux2;
+					trocaCelulas(&matriz, i, j, k, l);
 					aux--;
 				}
 			}
@@ -1107,7 +2383,7 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 2: Correção de conflitos de CURSO (R2)
 	// Faixa: 100 + bônus proporcional ao número de conflitos
 	// ========================================================================
-	else if((restricoes_violadas[2] != -1) && (movimento < 100 + (restricoes_violadas[2] >> 3))){
+	else if((restricoes_violadas[2] != -1) && (movimento < param.faixa_viz[0] + (restricoes_violadas[2] >> 3))){
 		if(restricoes_violadas[2] > 1000){
 			i = 0;
 			aux = -2;
@@ -1130,13 +2406,11 @@ Matriz geraViz(Matriz matriz){
 				
 				if(matriz.n[k][l] == -1){
 					aux2 = matriz.n[per][sal];
-					matriz.n[per][sal] = -1;
-					matriz.n[k][l] = aux2;
+					trocaCelulas(&matriz, per, sal, k, l);
 				}
 				else if(k != per){
 					aux2 = matriz.n[k][l];
-					matriz.n[k][l] = matriz.n[per][sal];
-					matriz.n[per][sal] = aux2;
+					trocaCelulas(&matriz, k, l, per, sal);
 				}
 			}
 			aux_mov_r22[aux] = -1;
@@ -1151,8 +2425,7 @@ Matriz geraViz(Matriz matriz){
 				l = randomInt(0, salas - 1);
 				if((matriz.n[i][j] != -1) || (matriz.n[k][l] != -1)){
 					aux2 = matriz.n[i][j];
-					matriz.n[i][j] = matriz.n[k][l];
-					matriz.n[k][l] = aux2;
+					trocaCelulas(&matriz, i, j, k, l);
 					aux--;
 				}
 			}
@@ -1163,7 +2436,7 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 3: Correção de COMPACIDADE (R6)
 	// Faixa: 100-200 + bônus proporcional às violações
 	// ========================================================================
-	else if((restricoes_violadas[6] != -1) && (movimento >= 100) && (movimento < 200 + (2 * restricoes_violadas[6]))){
+	else if((restricoes_violadas[6] != -1) && (movimento >= param.faixa_viz[0]) && (movimento < param.faixa_viz[1] + (2 * restricoes_violadas[6]))){
 		int r6_i, r6_j;
 		aux = -2;
 		k = 0;
@@ -1194,27 +2467,23 @@ Matriz geraViz(Matriz matriz){
 			l = randomInt(0, salas - 1);
 			
 			if((matriz.n[k][l] == -1) && (r6_i != k)){
-				matriz.n[k][l] = matriz.n[r6_i][r6_j];
-				matriz.n[r6_i][r6_j] = -1;
+				trocaCelulas(&matriz, k, l, r6_i, r6_j);
 				aux2 = 0;
 			}
 			else if((aux_mov_r6[k][l] != -1) && (r6_i != k)){
 				aux2 = matriz.n[k][l];
-				matriz.n[k][l] = matriz.n[r6_i][r6_j];
-				matriz.n[r6_i][r6_j] = aux2;
+				trocaCelulas(&matriz, k, l, r6_i, r6_j);
 				aux_mov_r6[k][l] = -1;
 			}
 			else if((aux3 >= tentativas) && (r6_i != k)){
 				aux2 = matriz.n[k][l];
 				aux = matriz.n[r6_i][r6_j];
-				matriz.n[k][l] = aux;
-				matriz.n[r6_i][r6_j] = aux2;
+				trocaCelulas(&matriz, k, l, r6_i, r6_j);
 				aux_mov_r6[k][l] = -1;
 			}
 			else if(aux3 >= tentativas){
 				aux2 = matriz.n[r6_i][r6_j];
-				matriz.n[r6_i][r6_j] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, r6_i, r6_j, k, l);
 			}
 			aux3++;
 		}
@@ -1226,7 +2495,7 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 4: Correção de CAPACIDADE (R7)
 	// Faixa: 200-300 + bônus proporcional às violações
 	// ========================================================================
-	else if((restricoes_violadas[7] != -1) && (movimento >= 200) && (movimento < 300 + restricoes_violadas[7])){
+	else if((restricoes_violadas[7] != -1) && (movimento >= param.faixa_viz[1]) && (movimento < param.faixa_viz[2] + restricoes_violadas[7])){
 		i = 0;
 		j = 0;
 		aux = -1;
@@ -1252,30 +2521,25 @@ Matriz geraViz(Matriz matriz){
 			
 			if((matriz.n[k][l] == -1) && (sala[l].capacidade >= disc[aux].alunos)){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = -1;
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			else if((matriz.n[k][l] != -1) && 
 			        (sala[l].capacidade >= disc[aux].alunos) && 
 			        (disc[matriz.n[k][l]].alunos - sala[l].capacidade > aux_mov_r7[aux][0])){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			else if((matriz.n[k][l] != -1) && (disc[matriz.n[k][l]].alunos > sala[l].capacidade)){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			else if((aux3 >= tentativas) && (sala[sal].capacidade > sala[l].capacidade)){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			else if(aux3 >= tentativas){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			aux3++;
 		}
@@ -1288,7 +2552,7 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 5: Correção de ESTABILIDADE (R8)
 	// Faixa: 300-400 + bônus proporcional às violações
 	// ========================================================================
-	else if((restricoes_violadas[8] != -1) && (movimento >= 300) && (movimento < 400 + restricoes_violadas[8])){
+	else if((restricoes_violadas[8] != -1) && (movimento >= param.faixa_viz[2]) && (movimento < param.faixa_viz[3] + restricoes_violadas[8])){
 		if(restricoes_violadas[8] >= total_periodos) 
 			aux = randomInt(0, total_periodos - 1);
 		else 
@@ -1296,7 +2560,8 @@ Matriz geraViz(Matriz matriz){
 		
 		sal = aux_mov_r8[aux] / total_periodos;
 		per = aux_mov_r8[aux] - (sal * total_periodos);
-		aux2 = -2;
+		// Posição guardada pode estar vazia nesta solução: nada a mover
+		aux2 = (matriz.n[per][sal] == -1) ? 0 : -2;
 		aux3 = 0;
 		
 		while(aux2 == -2){
@@ -1304,26 +2569,27 @@ Matriz geraViz(Matriz matriz){
 			j = r8[matriz.n[per][sal]];
 			
 			if(matriz.n[i][j] == -1){
-				matriz.n[i][j] = matriz.n[per][sal];
-				matriz.n[per][sal] = -1;
+				trocaCelulas(&matriz, i, j, per, sal);
 				aux2 = 1;
 			}
 			else if(aux3 >= tentativas){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[i][j];
-				matriz.n[i][j] = aux2;
+				trocaCelulas(&matriz, per, sal, i, j);
 			}
 			aux3++;
 		}
+		// Consome a violação tratada: a última posição válida ocupa seu lugar
+		// (r8[] é indexado por disciplina e não pode ser apagado aqui)
+		aux2 = (restricoes_violadas[8] < total_periodos) ? restricoes_violadas[8] : total_periodos - 1;
+		aux_mov_r8[aux] = aux_mov_r8[aux2];
 		restricoes_violadas[8]--;
-		r8[aux] = -1;
 	}
 
 	// ========================================================================
 	// MOVIMENTO 6: Correção de CARGA DE PROFESSORES (R9)
 	// Faixa: 400-500 + bônus proporcional às violações
 	// ========================================================================
-	else if((restricoes_violadas[9] != -1) && (movimento >= 400) && (movimento < 500 + (restricoes_violadas[9] * 20))){
+	else if((restricoes_violadas[9] != -1) && (movimento >= param.faixa_viz[3]) && (movimento < param.faixa_viz[4] + (restricoes_violadas[9] * 20))){
 		// Encontrar professor que viola R9
 		int prof_violador = -1;
 		int tentativa_prof = 0;
@@ -1337,38 +2603,49 @@ Matriz geraViz(Matriz matriz){
 		}
 		
 		if(prof_violador != -1){
-			// Identificar dias onde este professor trabalha
-			int dias_trabalhados[10];
+			// Identificar dias onde este professor tem aula nesta grade (lista de
+			// aulas; dias herdados da integral não têm aula para tirar)
+			int dias_trabalhados[dias];
 			int num_dias = 0;
-			
+			int per_fonte = -1;
+			int sala_fonte = -1;
+			int cel_fonte = -1;
+
+			setVetor(dias_trabalhados, dias, 0);
+			for(i = 0; i < qtDiscProf[prof_violador]; i++){
+				aux = discProf[prof_violador][i];
+				for(j = primeira_aula[aux]; j < primeira_aula[aux] + disc[aux].aulas; j++)
+					dias_trabalhados[(matriz.pos[j] / salas) / periodos_dia] = 1;
+			}
 			for(d = 0; d < dias; d++){
-				if(r9[prof_violador][d] == 1){
+				if(dias_trabalhados[d] == 1){
 					dias_trabalhados[num_dias++] = d;
 				}
 			}
 			
-			// Escolher dia "fonte" (para tirar aula) - escolher dia com menos aulas
-			int dia_fonte = dias_trabalhados[randomInt(0, num_dias - 1)];
-			
-			// Escolher dia "destino" (para concentrar) - escolher outro dia onde já trabalha
-			int dia_destino = dias_trabalhados[randomInt(0, num_dias - 1)];
-			while(dia_destino == dia_fonte && num_dias > 1){
+			if(num_dias > 0){
+				// Escolher dia "fonte" (para tirar aula)
+				int dia_fonte = dias_trabalhados[randomInt(0, num_dias - 1)];
+				
+				// Escolher dia "destino" (para concentrar) - escolher outro dia onde já trabalha
 				dia_destino = dias_trabalhados[randomInt(0, num_dias - 1)];
-			}
-			
-			// Encontrar uma aula deste professor no dia_fonte
-			int per_fonte = -1;
-			int sala_fonte = -1;
-			
-			for(per = dia_fonte * periodos_dia; per < (dia_fonte + 1) * periodos_dia; per++){
-				for(sal = 0; sal < salas; sal++){
-					if(matriz.n[per][sal] != -1 && disc[matriz.n[per][sal]].prof == prof_violador){
-						per_fonte = per;
-						sala_fonte = sal;
-						break;
+				while(dia_destino == dia_fonte && num_dias > 1){
+					dia_destino = dias_trabalhados[randomInt(0, num_dias - 1)];
+				}
+				
+				// Aula deste professor no dia_fonte (a primeira na ordem período/sala)
+				for(i = 0; i < qtDiscProf[prof_violador]; i++){
+					aux = discProf[prof_violador][i];
+					for(j = primeira_aula[aux]; j < primeira_aula[aux] + disc[aux].aulas; j++){
+						k = matriz.pos[j];
+						if(((k / salas) / periodos_dia == dia_fonte) && ((cel_fonte == -1) || (k < cel_fonte)))
+							cel_fonte = k;
 					}
 				}
-				if(per_fonte != -1) break;
+				if(cel_fonte != -1){
+					per_fonte = cel_fonte / salas;
+					sala_fonte = cel_fonte % salas;
+				}
 			}
 			
 			if(per_fonte != -1){
@@ -1382,21 +2659,18 @@ Matriz geraViz(Matriz matriz){
 					
 					// CASO 1: Slot vazio no dia destino
 					if(matriz.n[k][l] == -1){
-						matriz.n[k][l] = matriz.n[per_fonte][sala_fonte];
-						matriz.n[per_fonte][sala_fonte] = -1;
+						trocaCelulas(&matriz, k, l, per_fonte, sala_fonte);
 						aux2 = 0;
 					}
 					// CASO 2: Trocar com aula de outro professor que não viola R9
 					else if(aux_mov_r9[disc[matriz.n[k][l]].prof] <= 2){
 						aux2 = matriz.n[k][l];
-						matriz.n[k][l] = matriz.n[per_fonte][sala_fonte];
-						matriz.n[per_fonte][sala_fonte] = aux2;
+						trocaCelulas(&matriz, k, l, per_fonte, sala_fonte);
 					}
 					// CASO 3: Após tentativas, aceita qualquer troca
 					else if(aux3 >= tentativas){
 						aux2 = matriz.n[k][l];
-						matriz.n[k][l] = matriz.n[per_fonte][sala_fonte];
-						matriz.n[per_fonte][sala_fonte] = aux2;
+						trocaCelulas(&matriz, k, l, per_fonte, sala_fonte);
 					}
 					aux3++;
 				}
@@ -1408,7 +2682,7 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 7: Correção de TIPO DE SALA (R10)
 	// Faixa: 500-600 + bônus proporcional às violações
 	// ========================================================================
-	else if((restricoes_violadas[10] != -1) && (movimento >= 500) && (movimento < 600 + restricoes_violadas[10])){
+	else if((restricoes_violadas[10] != -1) && (movimento >= param.faixa_viz[4]) && (movimento < param.faixa_viz[5] + restricoes_violadas[10])){
 		i = 0;
 		j = 0;
 		aux = -1;
@@ -1438,28 +2712,24 @@ Matriz geraViz(Matriz matriz){
 			// CASO 1: Sala vazia e com tipo correto
 			if((matriz.n[k][l] == -1) && (sala[l].tipo_sala == disc[aux].tipo_sala)){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = -1;
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			// CASO 2: Troca que melhora ambas 
 			else if((matriz.n[k][l] != -1) && 
 			        (sala[l].tipo_sala == disc[aux].tipo_sala) && 
 			        (disc[matriz.n[k][l]].tipo_sala == sala[sal].tipo_sala)){ 
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			// CASO 3: Troca com disciplina também inadequada
 			else if((matriz.n[k][l] != -1) && (disc[matriz.n[k][l]].tipo_sala != sala[l].tipo_sala)){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			// CASO 4: Aceita qualquer troca
 			else if(aux3 >= tentativas){
 				aux2 = matriz.n[per][sal];
-				matriz.n[per][sal] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, per, sal, k, l);
 			}
 			aux3++;
 		}
@@ -1472,23 +2742,30 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 8: Correção de DISTRIBUIÇÃO (R11) 
 	// Faixa: 600-700 + bônus proporcional às violações
 	// ========================================================================
-	else if((restricoes_violadas[11] != -1) && (movimento >= 600) && (movimento < 700 + (restricoes_violadas[11] * 100))){
+	else if((restricoes_violadas[11] != -1) && (movimento >= param.faixa_viz[5]) && (movimento < param.faixa_viz[6] + (restricoes_violadas[11] * 100))){
 		// Procurar disciplina que viola R11
 		int disc_r11 = -1;
 		int per_r11 = -1;
 		int sal_r11 = -1;
 		int dia_r11 = -1;
 		
-		// Buscar em aux_mov_r11 
-		for(per = 0; per < total_periodos && disc_r11 == -1; per++){
-			for(sal = 0; sal < salas; sal++){
-				if(aux_mov_r11[per][sal] != -1){ 
-					disc_r11 = aux_mov_r11[per][sal];
-					per_r11 = per;
-					sal_r11 = sal;
-					dia_r11 = per / periodos_dia;
+		// Pela lista de aulas: a partir de uma disciplina sorteada, a primeira
+		// com duas aulas no mesmo dia (move a segunda delas)
+		int cel_dia[dias];
+		aux = randomInt(0, disciplinas - 1);
+		for(i = 0; (i < disciplinas) && (disc_r11 == -1); i++){
+			j = (aux + i) % disciplinas;
+			setVetor(cel_dia, dias, -1);
+			for(k = primeira_aula[j]; k < primeira_aula[j] + disc[j].aulas; k++){
+				dia = (matriz.pos[k] / salas) / periodos_dia;
+				if(cel_dia[dia] != -1){
+					disc_r11 = j;
+					per_r11 = matriz.pos[k] / salas;
+					sal_r11 = matriz.pos[k] % salas;
+					dia_r11 = dia;
 					break;
 				}
+				cel_dia[dia] = matriz.pos[k];
 			}
 		}
 		
@@ -1505,24 +2782,20 @@ Matriz geraViz(Matriz matriz){
 				// CASO 1: Dia diferente e slot vazio
 				if((d != dia_r11) && (matriz.n[k][l] == -1)){
 					aux2 = matriz.n[per_r11][sal_r11];
-					matriz.n[per_r11][sal_r11] = -1;
-					matriz.n[k][l] = aux2;
+					trocaCelulas(&matriz, per_r11, sal_r11, k, l);
 				}
 				// CASO 2: Dia diferente, trocar
 				else if(d != dia_r11){
 					aux2 = matriz.n[k][l];
-					matriz.n[k][l] = matriz.n[per_r11][sal_r11];
-					matriz.n[per_r11][sal_r11] = aux2;
+					trocaCelulas(&matriz, k, l, per_r11, sal_r11);
 				}
 				// CASO 3: Após tentativas, aceita qualquer mudança de dia
 				else if((aux3 >= tentativas) && (d != dia_r11)){
 					aux2 = matriz.n[k][l];
-					matriz.n[k][l] = matriz.n[per_r11][sal_r11];
-					matriz.n[per_r11][sal_r11] = aux2;
+					trocaCelulas(&matriz, k, l, per_r11, sal_r11);
 				}
 				aux3++;
 			}
-			aux_mov_r11[per_r11][sal_r11] = -1;  
 		}
 		// Movimento alternativo se não encontrou
 	}
@@ -1531,7 +2804,7 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 9: Troca aleatória no MESMO PERÍODO
 	// Faixa: 700-800
 	// ========================================================================
-	else if((movimento >= 700) && (movimento < 800)){
+	else if((movimento >= param.faixa_viz[6]) && (movimento < param.faixa_viz[7])){
 		aux = randomInt(1, tentativas << 1);
 		while(aux > 0){
 			i = randomInt(0, total_periodos - 1);
@@ -1539,8 +2812,7 @@ Matriz geraViz(Matriz matriz){
 			l = randomInt(0, salas - 1);
 			if((matriz.n[i][j] != -1) || (matriz.n[i][l] != -1)){
 				aux2 = matriz.n[i][j];
-				matriz.n[i][j] = matriz.n[i][l];
-				matriz.n[i][l] = aux2;
+				trocaCelulas(&matriz, i, j, i, l);
 				aux--;
 			}
 		}
@@ -1550,7 +2822,7 @@ Matriz geraViz(Matriz matriz){
 	// MOVIMENTO 10: Troca aleatória na MESMA SALA
 	// Faixa: 800-900
 	// ========================================================================
-	else if((movimento >= 800) && (movimento < 900)){
+	else if((movimento >= param.faixa_viz[7]) && (movimento < param.faixa_viz[8])){
 		aux = randomInt(1, tentativas << 1);
 		while(aux > 0){
 			i = randomInt(0, total_periodos - 1);
@@ -1558,8 +2830,7 @@ Matriz geraViz(Matriz matriz){
 			k = randomInt(0, total_periodos - 1);
 			if((matriz.n[i][j] != -1) || (matriz.n[k][j] != -1)){
 				aux2 = matriz.n[i][j];
-				matriz.n[i][j] = matriz.n[k][j];
-				matriz.n[k][j] = aux2;
+				trocaCelulas(&matriz, i, j, k, j);
 				aux--;
 			}
 		}
@@ -1578,8 +2849,7 @@ Matriz geraViz(Matriz matriz){
 			l = randomInt(0, salas - 1);
 			if((matriz.n[i][j] != -1) || (matriz.n[k][l] != -1)){
 				aux2 = matriz.n[i][j];
-				matriz.n[i][j] = matriz.n[k][l];
-				matriz.n[k][l] = aux2;
+				trocaCelulas(&matriz, i, j, k, l);
 				aux--;
 			}
 		}
@@ -1587,42 +2857,2195 @@ Matriz geraViz(Matriz matriz){
 	
 	return matriz;
 }
+
 // ============================================================================
-// FUNÇÕES DE TEMPO E EXIBIÇÃO
+// MOVIMENTOS COMPOSTOS (AVALIADOS POR DELTA)
 // ============================================================================
 
 /*
- * IMPRIMETEMPO: Formata e exibe tempo decorrido em HH:MM:SS.fff
+ * CONFLITAM: Verifica se duas disciplinas não podem ocupar o mesmo período
+ * (mesmo professor ou algum curso em comum - R2). Retorna 1 se conflitam.
  */
-void imprimeTempo(float Tempo, int hora, int minuto){
-	if(hora < 10)
-		if(minuto < 10)
-			if(Tempo < 10)
-				printf("\nTempo: 0%d:0%d:0%.3fs", hora, minuto, Tempo);
-			else printf("\nTempo: 0%d:0%d:%.3fs", hora, minuto, Tempo);
+int conflitam(int d1, int d2){
+	int a, b;
+
+	if((d1 == -1) || (d2 == -1)) return 0;
+	if((d1 == d2) || (disc[d1].prof == disc[d2].prof)) return 1;
+
+	// Intersecção das listas de cursos (ambas em ordem crescente)
+	a = 0;
+	b = 0;
+	while((a < disc[d1].qtCursos) && (b < disc[d2].qtCursos)){
+		if(disc[d1].listaCursos[a] == disc[d2].listaCursos[b]) return 1;
+		if(disc[d1].listaCursos[a] < disc[d2].listaCursos[b]) a++;
+		else b++;
+	}
+	return 0;
+}
+
+/*
+ * MOVIMENTOKEMPE: Troca os períodos p1 e p2 da cadeia de Kempe que começa
+ * na sala sal
+ * 
+ * A cadeia é um conjunto de salas (colunas): parte de sal e acrescenta toda
+ * sala cuja aula conflita (R2) com a aula de outra sala da cadeia no outro
+ * período. As colunas da cadeia são trocadas entre p1 e p2, então cada aula
+ * mantém a sala (R3) e nenhuma aula que fica conflita com uma que chega: se
+ * conflitasse, estaria na cadeia. Sem conflitos antes, sem conflitos depois.
+ * 
+ * Retorna o delta da FO, calculado de forma incremental.
+ */
+long long movimentoKempe(Matriz *matriz, Avaliador *av, int p1, int p2, int sal){
+	int i, j, r, inicio, fim;
+	int fila[salas];          // Salas da cadeia (na ordem da busca)
+	int na_cadeia[salas];     // 1 se a sala já está na cadeia
+
+	setVetor(na_cadeia, salas, 0);
+	fila[0] = sal;
+	na_cadeia[sal] = 1;
+	inicio = 0;
+	fim = 1;
+
+	// Busca em largura sobre as salas
+	while(inicio < fim){
+		r = fila[inicio++];
+		for(j = 0; j < salas; j++){
+			if(na_cadeia[j]) continue;
+			if(conflitam(matriz->n[p1][r], matriz->n[p2][j]) ||
+			   conflitam(matriz->n[p2][r], matriz->n[p1][j])){
+				na_cadeia[j] = 1;
+				fila[fim++] = j;
+			}
+		}
+	}
+
+	// Marca as células e avalia antes da troca
+	iniciaMovimento(av);
+	for(i = 0; i < fim; i++){
+		marcaCelula(av, *matriz, p1, fila[i]);
+		marcaCelula(av, *matriz, p2, fila[i]);
+	}
+	avaliaAntes(av, *matriz);
+
+	// Troca as colunas da cadeia entre os dois períodos
+	for(i = 0; i < fim; i++){
+		r = fila[i];
+		trocaCelulas(matriz, p1, r, p2, r);
+	}
+
+	return avaliaDepois(av, *matriz);
+}
+
+/*
+ * AULASDISCIPLINA: Lista as posições (período, sala) das aulas de uma
+ * disciplina, na ordem dos IDs das aulas. Retorna a quantidade (disc.aulas).
+ */
+int aulasDisciplina(Matriz matriz, int dis, int *pers, int *sals){
+	int i, n = 0;
+
+	for(i = primeira_aula[dis]; i < primeira_aula[dis] + disc[dis].aulas; i++){
+		pers[n] = matriz.pos[i] / salas;
+		sals[n] = matriz.pos[i] % salas;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * MOVIMENTOSALADISCIPLINA: Leva todas as aulas de uma disciplina para a
+ * sala alvo, cada uma no seu próprio período (R8)
+ * 
+ * Cada aula fora da sala alvo troca de lugar com o que estiver na sala alvo
+ * no mesmo período (aula de outra disciplina ou vazio). Os períodos não
+ * mudam, então os conflitos (R2) das aulas da disciplina se mantêm.
+ * 
+ * Retorna o delta da FO, calculado de forma incremental.
+ */
+long long movimentoSalaDisciplina(Matriz *matriz, Avaliador *av, int dis, int alvo){
+	int i, n;
+	int pers[disc[dis].aulas + 1], sals[disc[dis].aulas + 1];
+
+	n = aulasDisciplina(*matriz, dis, pers, sals);
+
+	iniciaMovimento(av);
+	for(i = 0; i < n; i++){
+		if(sals[i] == alvo) continue;
+		marcaCelula(av, *matriz, pers[i], sals[i]);
+		marcaCelula(av, *matriz, pers[i], alvo);
+	}
+	avaliaAntes(av, *matriz);
+
+	for(i = 0; i < n; i++){
+		// Já está na sala alvo, ou outra aula dela ocupa a sala alvo no período (R11)
+		if((sals[i] == alvo) || (matriz->n[pers[i]][alvo] == dis)) continue;
+		trocaCelulas(matriz, pers[i], alvo, pers[i], sals[i]);
+	}
+
+	return avaliaDepois(av, *matriz);
+}
+
+/*
+ * MOVIMENTOTROCADIAS: Troca o conteúdo inteiro de dois dias
+ * 
+ * Cada período do dia d1 troca com o período de mesma posição do dia d2,
+ * sala a sala. Conflitos (R2), compacidade (R6), capacidade (R7), tipo de
+ * sala (R10) e aulas por dia (R5, R11) ficam iguais; mudam a disponibilidade
+ * (R4), a ordem da primeira sala (R8) e os dias herdados da integral (R9).
+ * 
+ * Retorna o delta da FO, calculado de forma incremental.
+ */
+long long movimentoTrocaDias(Matriz *matriz, Avaliador *av, int d1, int d2){
+	int q, j, p1, p2;
+
+	iniciaMovimento(av);
+	for(q = 0; q < periodos_dia; q++){
+		for(j = 0; j < salas; j++){
+			marcaCelula(av, *matriz, d1 * periodos_dia + q, j);
+			marcaCelula(av, *matriz, d2 * periodos_dia + q, j);
+		}
+	}
+	avaliaAntes(av, *matriz);
+
+	for(q = 0; q < periodos_dia; q++){
+		p1 = d1 * periodos_dia + q;
+		p2 = d2 * periodos_dia + q;
+		for(j = 0; j < salas; j++){
+			trocaCelulas(matriz, p1, j, p2, j);
+		}
+	}
+
+	return avaliaDepois(av, *matriz);
+}
+
+/*
+ * MOVIMENTODIAPROFESSOR: Leva todas as aulas de um professor no dia origem
+ * para o dia destino (R9)
+ * 
+ * Cada aula vai para o mesmo período do dia e a mesma sala no destino,
+ * trocando com o que estiver lá. A sala não muda (R7, R10) e as aulas
+ * consecutivas do professor continuam consecutivas. Se alguma dessas
+ * células do destino já é do professor, a troca o devolveria à origem:
+ * o movimento é abandonado (mov_tipo = -1, solução intacta).
+ * 
+ * Retorna o delta da FO, calculado de forma incremental.
+ */
+long long movimentoDiaProfessor(Matriz *matriz, Avaliador *av, int pr, int origem, int destino){
+	int q, j, c, dis, po, pd, ocupante, n = 0;
+	int pers[periodos_dia * salas], sals[periodos_dia * salas];
+
+	// Aulas do professor no dia origem (pela lista de aulas)
+	for(q = 0; q < qtDiscProf[pr]; q++){
+		dis = discProf[pr][q];
+		for(j = primeira_aula[dis]; j < primeira_aula[dis] + disc[dis].aulas; j++){
+			c = matriz->pos[j];
+			if((c / salas) / periodos_dia == origem){
+				pers[n] = (c / salas) % periodos_dia;
+				sals[n] = c % salas;
+				ocupante = matriz->n[destino * periodos_dia + pers[n]][sals[n]];
+				if((ocupante != -1) && (disc[ocupante].prof == pr)){
+					av->mov_tipo = -1;
+					return 0;
+				}
+				n++;
+			}
+		}
+	}
+
+	iniciaMovimento(av);
+	for(q = 0; q < n; q++){
+		marcaCelula(av, *matriz, origem * periodos_dia + pers[q], sals[q]);
+		marcaCelula(av, *matriz, destino * periodos_dia + pers[q], sals[q]);
+	}
+	avaliaAntes(av, *matriz);
+
+	for(q = 0; q < n; q++){
+		po = origem * periodos_dia + pers[q];
+		pd = destino * periodos_dia + pers[q];
+		trocaCelulas(matriz, pd, sals[q], po, sals[q]);
+	}
+
+	return avaliaDepois(av, *matriz);
+}
+
+/*
+ * ESCOLHESALA: Sorteia uma sala adequada para a disciplina
+ * Prefere tipo correto (R10) e capacidade suficiente (R7); na falta,
+ * aceita só o tipo correto e, por fim, qualquer sala.
+ */
+int escolheSala(int dis){
+	int i, j, tipo_ok = -1;
+
+	for(i = 0; i < salas; i++){
+		j = randomInt(0, salas - 1);
+		if(sala[j].tipo_sala == disc[dis].tipo_sala){
+			if(sala[j].capacidade >= disc[dis].alunos)
+				return j;
+			if(tipo_ok == -1)
+				tipo_ok = j;
+		}
+	}
+	return (tipo_ok != -1) ? tipo_ok : randomInt(0, salas - 1);
+}
+
+/*
+ * MOVIMENTOCOMPOSTO: Sorteia e aplica um movimento composto na solução
+ * 
+ * 0. Kempe (só sem conflitos R2, que ele preserva)
+ * 1. Sala da disciplina: reúne uma disciplina espalhada em uma sala (R8)
+ * 2. Dia do professor: concentra um professor com mais de 2 dias (R9)
+ * 3. Troca de dias: troca o conteúdo de dois dias inteiros
+ * 
+ * Retorna o delta da FO (a solução já fica alterada).
+ */
+long long movimentoComposto(Matriz *matriz, Avaliador *av, int sem_conflitos){
+	int p1, p2, sal, dis, tentativas, n, tipo, pr, d, k;
+	int aulas_dia[dias];
+
+	tipo = randomInt(sem_conflitos ? 0 : 1, 3);
+	av->mov_tipo = -1;             // Nenhum movimento até achar um candidato
+	for(k = 0; k < 12; k++)
+		av->delta[k] = 0;          // Sem movimento, delta nulo em todas as restrições
+
+	// ------------------------------------------------------------------
+	// Kempe: dois períodos distintos e uma sala ocupada em um deles
+	// ------------------------------------------------------------------
+	if(tipo == 0){
+		p1 = randomInt(0, total_periodos - 1);
+		p2 = randomInt(0, total_periodos - 2);
+		if(p2 >= p1) p2++;
+
+		for(tentativas = 0; tentativas < salas; tentativas++){
+			sal = randomInt(0, salas - 1);
+			if((matriz->n[p1][sal] != -1) || (matriz->n[p2][sal] != -1)){
+				av->mov_tipo = 0;
+				av->mov_arg[0] = p1; av->mov_arg[1] = p2; av->mov_arg[2] = sal;
+				return movimentoKempe(matriz, av, p1, p2, sal);
+			}
+		}
+		return 0;  // Períodos vazios: nada a trocar
+	}
+
+	// ------------------------------------------------------------------
+	// Sala da disciplina: procura uma disciplina usando mais de uma sala
+	// ------------------------------------------------------------------
+	if(tipo == 1){
+		for(tentativas = 0; tentativas < 10; tentativas++){
+			dis = randomInt(0, disciplinas - 1);
+			p1 = primeira_aula[dis];
+			for(k = p1 + 1; k < p1 + disc[dis].aulas; k++){
+				if(matriz->pos[k] % salas != matriz->pos[p1] % salas){
+					av->mov_tipo = 1;
+					av->mov_arg[0] = dis; av->mov_arg[1] = escolheSala(dis);
+					return movimentoSalaDisciplina(matriz, av, dis, av->mov_arg[1]);
+				}
+			}
+		}
+		return 0;  // Nenhuma disciplina espalhada encontrada
+	}
+
+	// ------------------------------------------------------------------
+	// Dia do professor: tira o professor do dia em que tem menos aulas e o
+	// leva para outro dia em que já dá aula
+	// ------------------------------------------------------------------
+	if((tipo == 2) && (dias > 2)){
+		for(tentativas = 0; tentativas < 10; tentativas++){
+			pr = randomInt(0, professores - 1);
+			setVetor(aulas_dia, dias, 0);
+			for(k = 0; k < qtDiscProf[pr]; k++){
+				dis = discProf[pr][k];
+				for(p1 = primeira_aula[dis]; p1 < primeira_aula[dis] + disc[dis].aulas; p1++)
+					aulas_dia[(matriz->pos[p1] / salas) / periodos_dia]++;
+			}
+
+			n = 0;
+			p1 = -1;
+			for(d = 0; d < dias; d++){
+				if(aulas_dia[d] == 0) continue;
+				n++;
+				if((p1 == -1) || (aulas_dia[d] < aulas_dia[p1]))
+					p1 = d;
+			}
+			if(n <= 2) continue;  // Professor já respeita R9
+
+			// Destino: sorteia outro dia com aula do professor
+			do{
+				p2 = randomInt(0, dias - 1);
+			}while((p2 == p1) || (aulas_dia[p2] == 0));
+			av->mov_tipo = 2;
+			av->mov_arg[0] = pr; av->mov_arg[1] = p1; av->mov_arg[2] = p2;
+			return movimentoDiaProfessor(matriz, av, pr, p1, p2);
+		}
+		return 0;  // Nenhum professor violando R9 encontrado
+	}
+
+	// ------------------------------------------------------------------
+	// Troca de dias: dois dias distintos
+	// ------------------------------------------------------------------
+	if(dias < 2) return 0;
+	p1 = randomInt(0, dias - 1);
+	p2 = randomInt(0, dias - 2);
+	if(p2 >= p1) p2++;
+	av->mov_tipo = 3;
+	av->mov_arg[0] = p1; av->mov_arg[1] = p2;
+	return movimentoTrocaDias(matriz, av, p1, p2);
+}
+
+// ============================================================================
+// POLIMENTO - DESCIDA POR PRIMEIRA MELHORA EM PARALELO
+// ============================================================================
+
+/*
+ * NUMTHREADS: Threads das fases paralelas (núcleos disponíveis, até MAX_THREADS)
+ */
+int numThreads(){
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cpus < 1) ? 1 : (cpus > MAX_THREADS ? MAX_THREADS : (int) cpus);
+}
+
+/*
+ * CONTROLEPOLIMENTO: Rodada comum a todas as threads do polimento
+ * Escrito só pela thread principal, entre as barreiras.
+ */
+typedef struct controlePolimento{
+	pthread_barrier_t inicio;  // Libera as threads para a rodada
+	pthread_barrier_t fim;     // Todas terminaram a rodada
+	int encerrar;              // 1 = as threads saem
+	int bloco;                 // Primeira âncora do bloco da rodada
+	int tamanho;               // Âncoras no bloco
+	int mov_a;                 // Movimento aplicado desde a última rodada (-1 = nenhum)
+	int mov_b;
+}ControlePolimento;
+
+/*
+ * TAREFAPOLIMENTO: Parte da vizinhança avaliada por uma thread
+ * Cada thread trabalha na sua cópia da solução e com o seu avaliador.
+ */
+typedef struct tarefaPolimento{
+	int id;              // Índice da thread
+	int nthreads;        // Total de threads
+	ControlePolimento *c;
+	Matriz copia;        // Cópia da solução (a thread aplica e desfaz trocas)
+	Avaliador *av;       // Avaliação incremental da thread
+	long long melhor_delta;  // Melhor delta encontrado
+	int melhor_a;        // Células do melhor movimento (período * salas + sala)
+	int melhor_b;
+}TarefaPolimento;
+
+/*
+ * VARREVIZINHANCA: Thread do polimento. A cada rodada repete na sua cópia o
+ * movimento aplicado e avalia as trocas entre pares de células (a, b),
+ * b > a, com as âncoras a do bloco que lhe cabem (bloco + id, bloco + id +
+ * nthreads, ...). Trocar com uma célula vazia é realocar a aula, então a
+ * varredura cobre realocações e trocas de pares.
+ */
+void* varreVizinhanca(void *arg){
+	TarefaPolimento *t = (TarefaPolimento*) arg;
+	ControlePolimento *c = t->c;
+	int i, a, b, p1, s1, p2, s2;
+	long long delta;
+	int celulas = total_periodos * salas;
+
+	while(1){
+		pthread_barrier_wait(&c->inicio);
+		if(c->encerrar) break;
+		if(c->mov_a >= 0)
+			trocaCelulas(&t->copia, c->mov_a / salas, c->mov_a % salas, c->mov_b / salas, c->mov_b % salas);
+
+		t->melhor_delta = 0;
+		t->melhor_a = -1;
+		t->melhor_b = -1;
+
+		for(i = t->id; i < c->tamanho; i += t->nthreads){
+			a = (c->bloco + i) % celulas;
+			p1 = a / salas;
+			s1 = a % salas;
+			for(b = a + 1; b < celulas; b++){
+				p2 = b / salas;
+				s2 = b % salas;
+				if(t->copia.n[p1][s1] == t->copia.n[p2][s2])
+					continue;  // Duas vazias ou mesma disciplina: nada muda
+
+				iniciaMovimento(t->av);
+				marcaCelula(t->av, t->copia, p1, s1);
+				marcaCelula(t->av, t->copia, p2, s2);
+				avaliaAntes(t->av, t->copia);
+
+				trocaCelulas(&t->copia, p1, s1, p2, s2);
+
+				delta = avaliaDepois(t->av, t->copia);
+
+				// Desfaz a troca
+				trocaCelulas(&t->copia, p2, s2, p1, s1);
+
+				if(delta < t->melhor_delta){
+					t->melhor_delta = delta;
+					t->melhor_a = a;
+					t->melhor_b = b;
+				}
+			}
+		}
+		pthread_barrier_wait(&c->fim);
+	}
+	return NULL;
+}
+
+/*
+ * POLIMENTO: Descida por primeira melhora sobre realocações e trocas de aulas
+ * 
+ * As células-âncora são percorridas em blocos, em ordem circular; as
+ * threads (criadas uma vez) avaliam em paralelo as trocas das âncoras do
+ * bloco. Se o bloco tem movimento de melhora, o melhor dele é aplicado e o
+ * mesmo bloco é varrido de novo; senão a varredura segue para o próximo.
+ * Termina quando todas as âncoras foram varridas desde o último movimento
+ * aplicado (ótimo local para realocação de uma aula e para troca de duas),
+ * no limite (relogio(), 0 = sem limite) ou por sinal.
+ * 
+ * Retorna o número de movimentos aplicados (matriz->fo é atualizada).
+ */
+int polimento(Matriz *matriz, double limite){
+	int i, nthreads, passos = 0, melhor, a, b, sem_melhora = 0;
+	int celulas = total_periodos * salas;
+	ControlePolimento c;
+
+	nthreads = numThreads();
+
+	pthread_t threads[nthreads];
+	TarefaPolimento tarefa[nthreads];
+
+	pthread_barrier_init(&c.inicio, NULL, nthreads + 1);
+	pthread_barrier_init(&c.fim, NULL, nthreads + 1);
+	c.encerrar = 0;
+	c.bloco = 0;
+	c.tamanho = (nthreads * ANCORAS_POLIMENTO < celulas) ? nthreads * ANCORAS_POLIMENTO : celulas;
+	c.mov_a = c.mov_b = -1;
+
+	for(i = 0; i < nthreads; i++){
+		tarefa[i].id = i;
+		tarefa[i].nthreads = nthreads;
+		tarefa[i].c = &c;
+		tarefa[i].copia = criaMatriz();
+		tarefa[i].av = criaAvaliador();
+		copiaMatriz(&tarefa[i].copia, *matriz);
+		pthread_create(&threads[i], NULL, varreVizinhanca, &tarefa[i]);
+	}
+
+	while(sem_melhora < celulas){
+		if(atomic_load(&parar_busca)) break;  // Parada pedida por sinal
+		if((limite > 0) && (relogio() > limite)) break;
+
+		pthread_barrier_wait(&c.inicio);
+		pthread_barrier_wait(&c.fim);
+		c.mov_a = c.mov_b = -1;
+
+		// Melhor movimento do bloco (empate: thread de menor índice)
+		melhor = -1;
+		for(i = 0; i < nthreads; i++){
+			if(tarefa[i].melhor_a == -1) continue;
+			if((melhor == -1) || (tarefa[i].melhor_delta < tarefa[melhor].melhor_delta))
+				melhor = i;
+		}
+		if(melhor == -1){
+			sem_melhora += c.tamanho;
+			c.bloco = (c.bloco + c.tamanho) % celulas;
+			continue;
+		}
+
+		a = tarefa[melhor].melhor_a;
+		b = tarefa[melhor].melhor_b;
+		trocaCelulas(matriz, a / salas, a % salas, b / salas, b % salas);
+		matriz->fo += tarefa[melhor].melhor_delta;
+		c.mov_a = a;  // As threads repetem a troca na próxima rodada
+		c.mov_b = b;
+		sem_melhora = 0;
+		passos++;
+	}
+
+	c.encerrar = 1;
+	pthread_barrier_wait(&c.inicio);
+	for(i = 0; i < nthreads; i++){
+		pthread_join(threads[i], NULL);
+		liberaMatriz(tarefa[i].copia);
+		liberaAvaliador(tarefa[i].av);
+	}
+	pthread_barrier_destroy(&c.inicio);
+	pthread_barrier_destroy(&c.fim);
+	return passos;
+}
+
+// ============================================================================
+// DECOMPOSIÇÃO EM COMPONENTES INDEPENDENTES
+// ============================================================================
+
+/*
+ * Duas disciplinas estão ligadas no grafo de conflitos se têm o mesmo
+ * professor ou um curso em comum. Disciplinas de componentes diferentes só
+ * disputam salas: R2, R6 e R9 nunca cruzam componentes e as demais
+ * restrições são por célula ou por disciplina.
+ * 
+ * Os componentes são agrupados (balanceando o número de aulas) em até uma
+ * thread por núcleo e cada célula da grade pertence a um grupo: as células
+ * com aulas do grupo e uma cota das vazias, proporcional às aulas. Cada
+ * thread faz um SA de trocas entre as células do seu grupo (coordenação das
+ * salas pela posse das células), então a FO da grade montada é exatamente a
+ * inicial mais a soma dos deltas das threads.
+ */
+int* componente_disc = NULL;   // [disciplinas] componente de cada disciplina
+int  num_componentes = 0;      // Componentes do grafo de conflitos
+
+/*
+ * RAIZCOMPONENTE: Raiz do conjunto de x (union-find com compressão de caminho)
+ */
+int raizComponente(int *pai, int x){
+	while(pai[x] != x){
+		pai[x] = pai[pai[x]];
+		x = pai[x];
+	}
+	return x;
+}
+
+/*
+ * DECOMPOEINSTANCIA: Encontra os componentes conexos do grafo de conflitos
+ * (mesmo professor ou curso em comum) da instância carregada
+ */
+void decompoeInstancia(){
+	int i, j, a, b;
+	int pai[disciplinas + 1], rotulo[disciplinas + 1];
+
+	for(i = 0; i < disciplinas; i++)
+		pai[i] = i;
+
+	// Une as disciplinas de cada professor e de cada curso
+	for(i = 0; i < professores; i++){
+		for(j = 1; j < qtDiscProf[i]; j++){
+			a = raizComponente(pai, discProf[i][0]);
+			b = raizComponente(pai, discProf[i][j]);
+			if(a != b) pai[b] = a;
+		}
+	}
+	for(i = 0; i < cursos; i++){
+		for(j = 1; j < curso[i].qtDisc; j++){
+			a = raizComponente(pai, curso[i].disciplina[0]);
+			b = raizComponente(pai, curso[i].disciplina[j]);
+			if(a != b) pai[b] = a;
+		}
+	}
+
+	// Numera os componentes na ordem das disciplinas
+	free(componente_disc);
+	componente_disc = (int*) malloc((disciplinas + 1) * sizeof(int));
+	setVetor(rotulo, disciplinas, -1);
+	num_componentes = 0;
+	for(i = 0; i < disciplinas; i++){
+		a = raizComponente(pai, i);
+		if(rotulo[a] == -1)
+			rotulo[a] = num_componentes++;
+		componente_disc[i] = rotulo[a];
+	}
+}
+
+/*
+ * TAREFAGRUPO: Grupo de componentes resolvido por uma thread
+ */
+typedef struct tarefaGrupo{
+	Matriz copia;          // Cópia da grade (só as células do grupo mudam)
+	Avaliador *av;         // Avaliação incremental da thread
+	int *celulas;          // Células do grupo (período * salas + sala)
+	int nc;                // Quantidade de células
+	int aulas;             // Aulas do grupo
+	unsigned int semente;  // Semente do rand_r da thread
+	double limite;         // Fim pelo relógio (0 = sem limite)
+	long long delta;       // Variação da FO obtida pelo grupo
+}TarefaGrupo;
+
+/*
+ * RESOLVEGRUPO: SA de trocas entre as células de um grupo (uma thread)
+ * Usa rand_r: o gerador global do SA não é reentrante.
+ */
+void* resolveGrupo(void *arg){
+	TarefaGrupo *t = (TarefaGrupo*) arg;
+	Matriz *m = &t->copia;
+	double temp;
+	int it, iteracoes, a, b;
+	int pa, sa, pb, sb;
+	long long d, atual = 0;
+
+	t->delta = 0;
+	if(t->nc < 2) return NULL;
+
+	iteracoes = PASSOS_DECOMPOSICAO * (t->aulas + 1);
+	for(temp = TEMP_DECOMPOSICAO; (temp > 0.01) && !atomic_load(&parar_busca); temp *= 0.95){
+		if((t->limite > 0) && (relogio() > t->limite)) break;
+		for(it = 0; it < iteracoes; it++){
+			a = t->celulas[rand_r(&t->semente) % t->nc];
+			b = t->celulas[rand_r(&t->semente) % t->nc];
+			pa = a / salas; sa = a % salas;
+			pb = b / salas; sb = b % salas;
+			if((a == b) || (m->n[pa][sa] == m->n[pb][sb])) continue;
+
+			iniciaMovimento(t->av);
+			marcaCelula(t->av, *m, pa, sa);
+			marcaCelula(t->av, *m, pb, sb);
+			avaliaAntes(t->av, *m);
+			trocaCelulas(m, pa, sa, pb, sb);
+			d = avaliaDepois(t->av, *m);
+
+			if((d <= 0) || ((double) rand_r(&t->semente) / RAND_MAX < exp(-d / temp)))
+				atual += d;
+			else
+				trocaCelulas(m, pa, sa, pb, sb);  // Desfaz
+		}
+	}
+	t->delta = atual;
+	return NULL;
+}
+
+/*
+ * SOLUCAODECOMPOSTA: Resolve os grupos de componentes em paralelo e monta a
+ * grade com a parte de cada grupo, polindo o resultado em seguida; os SA
+ * dos grupos e o polimento param no limite (relogio(), 0 = sem limite)
+ * 
+ * Retorna o número de grupos resolvidos (0 se a instância não se divide).
+ */
+int solucaoDecomposta(Matriz *matriz, int nthreads, double limite){
+	int i, j, g, c, ngrupos, vazias, total;
+	int carga_comp[num_componentes + 1], grupo_comp[num_componentes + 1];
+	int ordem[num_componentes + 1];
+	int dono[total_periodos * salas];
+	int cota[MAX_THREADS], carga[MAX_THREADS];
+
+	ngrupos = (num_componentes < nthreads) ? num_componentes : nthreads;
+	if(ngrupos > MAX_THREADS) ngrupos = MAX_THREADS;
+	if(ngrupos < 2) return 0;
+
+	// Agrupa os componentes: maior carga primeiro, no grupo menos carregado
+	setVetor(carga_comp, num_componentes, 0);
+	for(i = 0; i < disciplinas; i++)
+		carga_comp[componente_disc[i]] += disc[i].aulas;
+	for(i = 0; i < num_componentes; i++)
+		ordem[i] = i;
+	for(i = 1; i < num_componentes; i++){
+		c = ordem[i];
+		for(j = i; (j > 0) && (carga_comp[ordem[j - 1]] < carga_comp[c]); j--)
+			ordem[j] = ordem[j - 1];
+		ordem[j] = c;
+	}
+	setVetor(carga, ngrupos, 0);
+	for(i = 0; i < num_componentes; i++){
+		g = 0;
+		for(j = 1; j < ngrupos; j++)
+			if(carga[j] < carga[g]) g = j;
+		grupo_comp[ordem[i]] = g;
+		carga[g] += carga_comp[ordem[i]];
+	}
+
+	// Posse das células: ocupadas pelo grupo da aula, vazias por cota
+	vazias = 0;
+	for(c = 0; c < total_periodos * salas; c++){
+		i = matriz->n[c / salas][c % salas];
+		dono[c] = (i == -1) ? -1 : grupo_comp[componente_disc[i]];
+		if(i == -1) vazias++;
+	}
+	total = 0;
+	for(g = 0; g < ngrupos; g++){
+		cota[g] = (int)((long) vazias * carga[g] / (total_aulas > 0 ? total_aulas : 1));
+		total += cota[g];
+	}
+	cota[0] += vazias - total;  // Sobra do arredondamento
+	g = 0;
+	for(c = 0; c < total_periodos * salas; c++){
+		if(dono[c] != -1) continue;
+		// Distribui em rodízio, pulando grupos com a cota esgotada
+		for(j = 0; (j < ngrupos) && (cota[g] == 0); j++)
+			g = (g + 1) % ngrupos;
+		dono[c] = g;
+		cota[g]--;
+		g = (g + 1) % ngrupos;
+	}
+
+	pthread_t threads[ngrupos];
+	TarefaGrupo tarefa[ngrupos];
+
+	for(g = 0; g < ngrupos; g++){
+		tarefa[g].copia = criaMatriz();
+		copiaMatriz(&tarefa[g].copia, *matriz);
+		tarefa[g].av = criaAvaliador();
+		tarefa[g].celulas = (int*) malloc(total_periodos * salas * sizeof(int));
+		tarefa[g].nc = 0;
+		tarefa[g].aulas = carga[g];
+		tarefa[g].semente = (unsigned int) aleatorio();
+		tarefa[g].limite = limite;
+	}
+	for(c = 0; c < total_periodos * salas; c++)
+		tarefa[dono[c]].celulas[tarefa[dono[c]].nc++] = c;
+
+	for(g = 0; g < ngrupos; g++)
+		pthread_create(&threads[g], NULL, resolveGrupo, &tarefa[g]);
+	for(g = 0; g < ngrupos; g++)
+		pthread_join(threads[g], NULL);
+
+	// Monta a grade: cada célula vem da cópia do seu grupo
+	for(c = 0; c < total_periodos * salas; c++){
+		i = c / salas;
+		j = c % salas;
+		matriz->n[i][j] = tarefa[dono[c]].copia.n[i][j];
+		matriz->a[i][j] = tarefa[dono[c]].copia.a[i][j];
+		if(matriz->a[i][j] != -1)
+			matriz->pos[matriz->a[i][j]] = c;
+	}
+	matriz->hash = calculaHash(*matriz);
+	for(g = 0; g < ngrupos; g++){
+		matriz->fo += tarefa[g].delta;
+		liberaMatriz(tarefa[g].copia);
+		liberaAvaliador(tarefa[g].av);
+		free(tarefa[g].celulas);
+	}
+
+	// Polimento conjunto (movimentos entre grupos)
+	polimento(matriz, limite);
+	return ngrupos;
+}
+
+// ============================================================================
+// CONJUNTO ELITE E RELIGAÇÃO DE CAMINHOS
+// ============================================================================
+
+/*
+ * ELITE: As melhores soluções distintas encontradas na instância
+ * Duas soluções só convivem se tiverem hash diferente e diferirem em pelo
+ * menos DIST_MIN_ELITE células (distância de Hamming entre as grades).
+ */
+typedef struct elite{
+	int capacidade;      // Máximo de soluções guardadas
+	int quantidade;      // Soluções guardadas
+	Matriz *sol;         // [capacidade] soluções (fo e hash válidos)
+}Elite;
+
+Elite *elite = NULL;     // Conjunto elite da instância corrente
+
+/*
+ * CRIAELITE: Aloca um conjunto elite vazio
+ */
+Elite* criaElite(int capacidade){
+	int i;
+	Elite *e = (Elite*) malloc(sizeof(Elite));
+
+	e->capacidade = capacidade;
+	e->quantidade = 0;
+	e->sol = (Matriz*) malloc(capacidade * sizeof(Matriz));
+	for(i = 0; i < capacidade; i++)
+		e->sol[i] = criaMatriz();
+	return e;
+}
+
+/*
+ * LIBERAELITE: Libera o conjunto elite
+ */
+void liberaElite(Elite *e){
+	int i;
+	for(i = 0; i < e->capacidade; i++)
+		liberaMatriz(e->sol[i]);
+	free(e->sol);
+	free(e);
+}
+
+/*
+ * DISTANCIAHAMMING: Número de células com conteúdo diferente
+ */
+int distanciaHamming(Matriz a, Matriz b){
+	int i, j, d = 0;
+
+	for(i = 0; i < total_periodos; i++)
+		for(j = 0; j < salas; j++)
+			if(a.n[i][j] != b.n[i][j])
+				d++;
+	return d;
+}
+
+/*
+ * OFERECEELITE: Tenta incluir uma solução no conjunto elite
+ * - Repetida (mesmo hash): ignorada
+ * - Próxima demais de outra: substitui essa outra, se for melhor
+ * - Caso contrário: entra se houver espaço ou se superar a pior
+ * Retorna 1 se a solução entrou no conjunto.
+ */
+int ofereceElite(Elite *e, Matriz matriz){
+	int i, alvo = -1, pior = -1;
+
+	for(i = 0; i < e->quantidade; i++){
+		if(e->sol[i].hash == matriz.hash)
+			return 0;
+		if((pior == -1) || (e->sol[i].fo > e->sol[pior].fo))
+			pior = i;
+	}
+
+	// Diversidade: a mais próxima dentro da distância mínima
+	for(i = 0; i < e->quantidade; i++){
+		if(distanciaHamming(e->sol[i], matriz) < DIST_MIN_ELITE){
+			alvo = i;
+			break;
+		}
+	}
+
+	if(alvo != -1){
+		if(matriz.fo >= e->sol[alvo].fo) return 0;
+	}
+	else if(e->quantidade < e->capacidade)
+		alvo = e->quantidade++;
+	else if(matriz.fo < e->sol[pior].fo)
+		alvo = pior;
+	else
+		return 0;
+
+	copiaMatriz(&e->sol[alvo], matriz);
+	return 1;
+}
+
+/*
+ * RELIGACAMINHO: Caminha da solução origem até a guia, uma troca por passo
+ * 
+ * A cada passo sorteia até AMOSTRA_RELIGACAO células em que as grades
+ * diferem, avalia (delta incremental) a troca que coloca ali o conteúdo da
+ * guia e aplica a melhor. Toda troca acerta ao menos uma célula, então o
+ * caminho termina na guia. As duas grades têm as mesmas aulas (R1), logo a
+ * aula procurada sempre existe em outra célula ainda divergente.
+ * 
+ * Guarda em *saida a melhor solução intermediária e retorna sua FO
+ * (-1 se as soluções são vizinhas e não há ponto intermediário).
+ */
+long long religaCaminho(Matriz origem, Matriz guia, Matriz *saida, Avaliador *av){
+	int i, k, a, b, c, e, melhor_c, melhor_e, nd;
+	long long delta, melhor_delta, melhor_fo = -1;
+	int celulas = total_periodos * salas;
+	int *dif = (int*) malloc(celulas * sizeof(int));
+	Matriz cur = criaMatriz();
+
+	copiaMatriz(&cur, origem);
+	nd = 0;
+	for(c = 0; c < celulas; c++)
+		if(cur.n[c / salas][c % salas] != guia.n[c / salas][c % salas])
+			dif[nd++] = c;
+
+	while(nd > 0){
+		melhor_c = -1;
+		melhor_e = -1;
+		melhor_delta = 0;
+
+		for(k = 0; k < AMOSTRA_RELIGACAO; k++){
+			c = dif[randomInt(0, nd - 1)];
+			a = guia.n[c / salas][c % salas];  // Conteúdo que a célula c deve receber
+
+			// Outra célula divergente com esse conteúdo
+			e = -1;
+			for(i = 0; i < nd; i++){
+				b = dif[i];
+				if((b != c) && (cur.n[b / salas][b % salas] == a)){
+					e = b;
+					break;
+				}
+			}
+			if(e == -1) continue;
+
+			iniciaMovimento(av);
+			marcaCelula(av, cur, c / salas, c % salas);
+			marcaCelula(av, cur, e / salas, e % salas);
+			avaliaAntes(av, cur);
+			trocaCelulas(&cur, c / salas, c % salas, e / salas, e % salas);
+			delta = avaliaDepois(av, cur);
+			trocaCelulas(&cur, c / salas, c % salas, e / salas, e % salas);
+
+			if((melhor_c == -1) || (delta < melhor_delta)){
+				melhor_delta = delta;
+				melhor_c = c;
+				melhor_e = e;
+			}
+		}
+		if(melhor_c == -1) break;  // Não deveria ocorrer (R1 garante o par)
+
+		trocaCelulas(&cur, melhor_c / salas, melhor_c % salas, melhor_e / salas, melhor_e % salas);
+		cur.fo += melhor_delta;
+
+		// Remove as células que passaram a coincidir com a guia
+		k = 0;
+		for(i = 0; i < nd; i++){
+			c = dif[i];
+			if(cur.n[c / salas][c % salas] != guia.n[c / salas][c % salas])
+				dif[k++] = c;
+		}
+		nd = k;
+
+		// Ponto intermediário (a guia em si não conta)
+		if((nd > 0) && ((melhor_fo == -1) || (cur.fo < melhor_fo))){
+			melhor_fo = cur.fo;
+			copiaMatriz(saida, cur);
+		}
+	}
+
+	free(dif);
+	liberaMatriz(cur);
+	return melhor_fo;
+}
+
+/*
+ * RELIGACAOELITE: Religa todos os pares (ordenados) do conjunto elite
+ * As melhores soluções intermediárias são oferecidas ao conjunto e a melhor
+ * de todas substitui *melhor se for superior. Não começa caminhos depois
+ * do limite (relogio(), 0 = sem limite) nem com parada pedida. Retorna
+ * quantos caminhos produziram solução melhor que as duas pontas.
+ */
+int religacaoElite(Elite *e, Matriz *melhor, Avaliador *av, double limite){
+	int i, j, k, n = e->quantidade, sucesso = 0;
+	long long fo;
+	Matriz inter = criaMatriz();
+	Matriz *achados = (Matriz*) malloc(n * n * sizeof(Matriz));
+	int qt = 0;
+
+	// Caminhos entre as soluções atuais do conjunto (sem misturar com os achados)
+	for(i = 0; i < n; i++){
+		for(j = 0; j < n; j++){
+			if(i == j) continue;
+			if(atomic_load(&parar_busca) || ((limite > 0) && (relogio() > limite))) break;
+			fo = religaCaminho(e->sol[i], e->sol[j], &inter, av);
+			if((fo != -1) && (fo < e->sol[i].fo) && (fo < e->sol[j].fo)){
+				achados[qt] = criaMatriz();
+				copiaMatriz(&achados[qt], inter);
+				qt++;
+				sucesso++;
+			}
+		}
+	}
+
+	for(k = 0; k < qt; k++){
+		ofereceElite(e, achados[k]);
+		if(achados[k].fo < melhor->fo)
+			copiaMatriz(melhor, achados[k]);
+		liberaMatriz(achados[k]);
+	}
+
+	free(achados);
+	liberaMatriz(inter);
+	return sucesso;
+}
+
+// ============================================================================
+// FUNÇÕES DE TEMPO E EXIBIÇÃO
+// ============================================================================
+
+/*
+ * IMPRIMETEMPO: Formata e escreve em fp o tempo decorrido em HH:MM:SS.fff
+ */
+void imprimeTempo(FILE *fp, float Tempo, int hora, int minuto){
+	if(hora < 10)
+		if(minuto < 10)
+			if(Tempo < 10)
+				fprintf(fp, "\nTempo: 0%d:0%d:0%.3fs", hora, minuto, Tempo);
+			else fprintf(fp, "\nTempo: 0%d:0%d:%.3fs", hora, minuto, Tempo);
 		else if(Tempo < 10)
-				printf("\nTempo: 0%d:%d:0%.3fs", hora, minuto, Tempo);
-			else printf("\nTempo: 0%d:%d:%.3fs", hora, minuto, Tempo);
+				fprintf(fp, "\nTempo: 0%d:%d:0%.3fs", hora, minuto, Tempo);
+			else fprintf(fp, "\nTempo: 0%d:%d:%.3fs", hora, minuto, Tempo);
 	else if(minuto < 10)
 			if(Tempo < 10)
-				printf("\nTempo: %d:0%d:0%.3fs", hora, minuto, Tempo);
-			else printf("\nTempo: %d:0%d:%.3fs", hora, minuto, Tempo);
+				fprintf(fp, "\nTempo: %d:0%d:0%.3fs", hora, minuto, Tempo);
+			else fprintf(fp, "\nTempo: %d:0%d:%.3fs", hora, minuto, Tempo);
 		else if(Tempo < 10)
-				printf("\nTempo: %d:%d:0%.3fs", hora, minuto, Tempo);
-			else printf("\nTempo: %d:%d:%.3fs", hora, minuto, Tempo);
+				fprintf(fp, "\nTempo: %d:%d:0%.3fs", hora, minuto, Tempo);
+			else fprintf(fp, "\nTempo: %d:%d:%.3fs", hora, minuto, Tempo);
+}
+
+/*
+ * ALTERA_PARAMETROS: Ajusta iterações e resfriamento à faixa da temperatura T
+ * 
+ * Faixas padrão (param.limiar):
+ * - T > 1000: MUITO ALTA, exploração rápida (600 iterações, alpha 0.98)
+ * - T > 100: ALTA, exploração moderada (800, 0.97)
+ * - T > 10: MÉDIA, balanceamento (1000, 0.98)
+ * - T > 1: BAIXA, intensificação (1200, 0.99)
+ * - T > 0.1: MUITO BAIXA, refinamento (1500, 0.993)
+ * - demais: EXTREMAMENTE BAIXA, busca local (1200, 0.995)
+ */
+void altera_parametros(){
+	int f = 0;
+
+	while((f < NUM_FAIXAS_T - 1) && (T <= param.limiar[f]))
+		f++;
+	maxIteracoes = param.iteracoes[f];
+	alpha = param.alpha[f];
+}
+
+// ============================================================================
+// CONTADORES DE HARDWARE POR FASE (perf_event_open)
+// ============================================================================
+
+/*
+ * Compilado com -DCONTADORES_HW, mede ciclos, instruções, faltas de cache
+ * e desvios mal previstos de cada fase da resolução: leitura, construção
+ * (solução inicial e decomposição), cada passo de temperatura do SA e,
+ * dentro dele, a avaliação (calcula_FO) e a geração de movimentos (geraViz
+ * e movimentoComposto, que já inclui o delta). Os quatro contadores formam
+ * um grupo (lidos juntos, na mesma janela de multiplexação) da thread
+ * principal, só em modo usuário: as threads do polimento e da decomposição
+ * não entram na conta.
+ * 
+ * Sem a opção, INICIO_FASE/FIM_FASE não geram código. Se o kernel negar
+ * perf_event_open (perf_event_paranoid, contêiner, máquina virtual sem
+ * PMU), segue sem medir e o relatório traz o motivo.
+ * O relatório sai no terminal e no arquivo de resultado da grade.
+ */
+#ifdef CONTADORES_HW
+
+/*
+ * FASE: Contadores acumulados de uma fase
+ */
+typedef struct fase{
+	unsigned long long soma[NUM_CONTADORES];    // Totais acumulados
+	unsigned long long inicio[NUM_CONTADORES];  // Leitura no início da execução em curso
+	long vezes;                                 // Execuções da fase
+}Fase;
+
+Fase fases[NUM_FASES];
+int  fd_contadores[NUM_CONTADORES] = {-1, -1, -1, -1};
+int  contadores_ativos = 0;
+char erro_contadores[SIZE] = "";             // Motivo de não medir (vai no relatório)
+const char *nome_fase[NUM_FASES] = {"Leitura", "Construção", "Passo do SA", "Avaliação", "Movimentos"};
+
+/*
+ * ABRECONTADOR: Abre um evento de hardware da thread atual no grupo do
+ * líder (lider = -1: abre o líder, desligado até iniciaContadores ligar)
+ */
+int abreContador(unsigned long long config, int lider){
+	struct perf_event_attr pe;
+
+	memset(&pe, 0, sizeof(pe));
+	pe.type = PERF_TYPE_HARDWARE;
+	pe.size = sizeof(pe);
+	pe.config = config;
+	pe.disabled = (lider == -1);
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+	pe.read_format = PERF_FORMAT_GROUP;
+	return (int) syscall(__NR_perf_event_open, &pe, 0, -1, lider, 0);
+}
+
+/*
+ * INICIACONTADORES: Zera as fases (nova grade) e abre o grupo na primeira vez
+ */
+void iniciaContadores(){
+	unsigned long long config[NUM_CONTADORES] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+	                                             PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+	int i, j;
+
+	memset(fases, 0, sizeof(fases));
+	if(contadores_ativos) return;
+
+	for(i = 0; i < NUM_CONTADORES; i++){
+		fd_contadores[i] = abreContador(config[i], (i == 0) ? -1 : fd_contadores[0]);
+		if(fd_contadores[i] < 0){
+			snprintf(erro_contadores, SIZE, "%s", strerror(errno));
+			for(j = 0; j < i; j++){
+				close(fd_contadores[j]);
+				fd_contadores[j] = -1;
+			}
+			return;
+		}
+	}
+	ioctl(fd_contadores[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(fd_contadores[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	contadores_ativos = 1;
+}
+
+/*
+ * LECONTADORES: Lê o grupo inteiro (formato: quantidade e os valores)
+ */
+int leContadores(unsigned long long *valores){
+	unsigned long long buf[1 + NUM_CONTADORES];
+
+	if(read(fd_contadores[0], buf, sizeof(buf)) != (ssize_t) sizeof(buf))
+		return 0;
+	memcpy(valores, buf + 1, NUM_CONTADORES * sizeof(unsigned long long));
+	return 1;
+}
+
+/*
+ * INICIOFASE / FIMFASE: Delimitam uma execução da fase f
+ */
+void inicioFase(int f){
+	if(contadores_ativos)
+		leContadores(fases[f].inicio);
+}
+
+void fimFase(int f){
+	unsigned long long v[NUM_CONTADORES];
+	int k;
+
+	if(!contadores_ativos || !leContadores(v)) return;
+	for(k = 0; k < NUM_CONTADORES; k++)
+		fases[f].soma[k] += v[k] - fases[f].inicio[k];
+	fases[f].vezes++;
+}
+
+/*
+ * RELATORIOCONTADORES: Totais por fase, IPC e taxas de falta
+ */
+void relatorioContadores(FILE *fp){
+	int f, n;
+	const char *p;
+	Fase *c;
+
+	fprintf(fp, "\n============ CONTADORES DE HARDWARE ============\n");
+	if(!contadores_ativos){
+		fprintf(fp, "Indisponíveis: %s\n", erro_contadores);
+		return;
+	}
+	fprintf(fp, "Fase         %10s %14s %16s %6s %12s %13s\n",  // Larguras em bytes (UTF-8)
+	        "Vezes", "Ciclos", "Instruções", "IPC", "Falta cache", "Desvio errado");
+	for(f = 0; f < NUM_FASES; f++){
+		c = &fases[f];
+		for(n = 0, p = nome_fase[f]; *p; p++)
+			if((*p & 0xC0) != 0x80) n++;  // Caracteres, não bytes
+		fprintf(fp, "%s%*s", nome_fase[f], 12 - n, "");
+		fprintf(fp, " %10ld %14llu %14llu %6.2f %12llu %13llu\n", c->vezes,
+		        c->soma[0], c->soma[1], c->soma[0] ? (double) c->soma[1] / c->soma[0] : 0.0,
+		        c->soma[2], c->soma[3]);
+	}
+	fprintf(fp, "=================================================\n");
+}
+
+#define INICIO_FASE(f) inicioFase(f)
+#define FIM_FASE(f) fimFase(f)
+#else
+#define INICIO_FASE(f)
+#define FIM_FASE(f)
+#endif
+
+// ============================================================================
+// REGISTRO ASSÍNCRONO (LOG)
+// ============================================================================
+
+/*
+ * As mensagens do laço do SA (nova melhor solução), da solução inicial e da
+ * thread gravadora viram eventos estruturados numa fila circular sem trava
+ * (fila limitada de Vyukov: cada posição tem um número de sequência, os
+ * produtores reservam posições com CAS e só a thread de log consome). A
+ * thread de log formata os eventos como texto (o formato antigo) ou como
+ * JSON, um por linha. Fila cheia descarta o evento (a busca nunca espera)
+ * e os descartes são contados.
+ * 
+ * O nível é filtrado no produtor: -q (silencioso) só deixa avisos e erros,
+ * -v inclui a depuração (aulas de cada disciplina na solução inicial).
+ * Antes de qualquer printf direto fora do laço, esvaziaLog garante a ordem
+ * da saída. Sem iniciaLog os eventos são escritos na hora.
+ */
+typedef struct evento{
+	atomic_uint seq;       // Número de sequência da posição na fila
+	int tipo;              // LOG_EVENTO_*
+	int nivel;             // LOG_ERRO ... LOG_DEPURACAO
+	double segundos;       // Tempo real desde iniciaLog
+	float f[2];            // Campos reais do evento
+	long long v[8];        // Campos inteiros do evento
+	char texto[SIZE * 3];  // Mensagem livre (cabe um caminho de SIZE * 2)
+}Evento;
+
+#define LOG_EVENTO_MELHORA 0     // Nova melhor solução no SA
+#define LOG_EVENTO_DISCIPLINA 1  // Aulas de uma disciplina (solução inicial)
+#define LOG_EVENTO_MENSAGEM 2    // Texto livre
+
+Evento fila_log[TAM_LOG];
+atomic_uint log_cauda = 0;         // Próxima posição a reservar (produtores)
+atomic_uint log_cabeca = 0;        // Próxima posição a consumir (thread de log)
+atomic_ulong log_descartados = 0;  // Eventos perdidos com a fila cheia
+atomic_int log_encerrar = 0;       // Pede o fim da thread de log
+int log_ativo = 0;                 // Thread de log em execução
+pthread_t thread_log;
+double inicio_log = 0;
+
+int   nivel_log = LOG_INFO;        // Eventos acima deste nível são ignorados
+int   log_json = 0;                // 1 = JSON por linha, 0 = texto
+FILE *saida_log = NULL;            // Destino do log (NULL = stdout)
+
+/*
+ * ESCREVEEVENTO: Formata um evento no destino do log
+ */
+void escreveEvento(Evento *e){
+	const char *niveis[] = {"erro", "aviso", "info", "depuracao"};
+	FILE *fp = saida_log ? saida_log : stdout;
+	char *c;
+
+	if(log_json){
+		fprintf(fp, "{\"t\":%.6f,\"nivel\":\"%s\",", e->segundos, niveis[e->nivel]);
+		switch(e->tipo){
+			case LOG_EVENTO_MELHORA:
+				fprintf(fp, "\"evento\":\"melhora\",\"T\":%.6f,\"atual\":%lld,\"viz\":%lld,\"melhor\":%lld,"
+				        "\"programa\":%lld,\"rotina\":%lld,\"estagnacao\":%lld}\n",
+				        e->f[0], e->v[0], e->v[1], e->v[2], e->v[3], e->v[4], e->v[5]);
+				break;
+			case LOG_EVENTO_DISCIPLINA:
+				fprintf(fp, "\"evento\":\"disciplina\",\"disc\":%lld,\"aulas\":%lld}\n", e->v[0], e->v[1]);
+				break;
+			default:
+				fprintf(fp, "\"evento\":\"mensagem\",\"texto\":\"");
+				for(c = e->texto; *c; c++){
+					if((*c == '"') || (*c == '\\'))
+						fprintf(fp, "\\%c", *c);
+					else if((unsigned char) *c < 0x20)
+						fprintf(fp, "\\u%04x", *c);  // Controle (\n, \t, ...)
+					else
+						fputc(*c, fp);
+				}
+				fprintf(fp, "\"}\n");
+		}
+		return;
+	}
+
+	switch(e->tipo){
+		case LOG_EVENTO_MELHORA:
+			imprimeTempo(fp, e->f[1], (int) e->v[6], (int) e->v[7]);
+			if(e->v[1] >= 1000000)
+				fprintf(fp, "|  Temp(K) = %.6f \t|  atual.fo = %lld \t|  viz.fo = %lld\t|  melhor.fo = %lld\t (%lld)(%lld)(%lld)",
+				        e->f[0], e->v[0], e->v[1], e->v[2], e->v[3], e->v[4], e->v[5]);
+			else
+				fprintf(fp, "|  Temp(K) = %.4f \t|  atual.fo = %lld \t|  viz.fo = %lld   \t|  melhor.fo = %lld\t (%lld)(%lld)(%lld)",
+				        e->f[0], e->v[0], e->v[1], e->v[2], e->v[3], e->v[4], e->v[5]);
+			break;
+		case LOG_EVENTO_DISCIPLINA:
+			fprintf(fp, "disc[%lld].aulas: %lld\n", e->v[0], e->v[1]);
+			break;
+		default:
+			fprintf(fp, "%s", e->texto);
+	}
+}
+
+/*
+ * REGISTRAEVENTO: Enfileira um evento (qualquer thread, sem bloquear)
+ * Os campos não usados pelo tipo podem vir zerados.
+ */
+void registraEvento(int nivel, int tipo, float f0, float f1, const long long *v, int nv, const char *texto){
+	Evento *e, local;
+	unsigned int pos = 0, seq;
+	int i;
+
+	if(nivel > nivel_log) return;
+
+	if(!log_ativo){
+		e = &local;  // Sem thread de log: escreve na hora
+	}
+	else{
+		pos = atomic_load_explicit(&log_cauda, memory_order_relaxed);
+		while(1){
+			e = &fila_log[pos % TAM_LOG];
+			seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+			if((int)(seq - pos) == 0){
+				if(atomic_compare_exchange_weak_explicit(&log_cauda, &pos, pos + 1,
+				                                         memory_order_relaxed, memory_order_relaxed))
+					break;  // Posição reservada
+			}
+			else if((int)(seq - pos) < 0){
+				atomic_fetch_add_explicit(&log_descartados, 1, memory_order_relaxed);
+				return;  // Fila cheia
+			}
+			else{
+				pos = atomic_load_explicit(&log_cauda, memory_order_relaxed);
+			}
+		}
+	}
+
+	e->tipo = tipo;
+	e->nivel = nivel;
+	e->segundos = relogio() - inicio_log;
+	e->f[0] = f0;
+	e->f[1] = f1;
+	for(i = 0; i < 8; i++)
+		e->v[i] = (i < nv) ? v[i] : 0;
+	if(texto != NULL){
+		strncpy(e->texto, texto, sizeof(e->texto) - 1);
+		e->texto[sizeof(e->texto) - 1] = '\0';
+	}
+	else e->texto[0] = '\0';
+
+	if(!log_ativo)
+		escreveEvento(e);
+	else
+		atomic_store_explicit(&e->seq, pos + 1, memory_order_release);  // Publica
+}
+
+/*
+ * REGISTRAMENSAGEM: Evento de texto livre, formatado como printf
+ */
+void registraMensagem(int nivel, const char *formato, ...){
+	char texto[SIZE * 3];
+	va_list args;
+
+	if(nivel > nivel_log) return;
+	va_start(args, formato);
+	vsnprintf(texto, sizeof(texto), formato, args);
+	va_end(args);
+	registraEvento(nivel, LOG_EVENTO_MENSAGEM, 0, 0, NULL, 0, texto);
+}
+
+/*
+ * CONSOMELOG: Escreve os eventos publicados. Retorna quantos escreveu.
+ */
+int consomeLog(){
+	Evento *e;
+	unsigned int pos;
+	int n = 0;
+
+	pos = atomic_load_explicit(&log_cabeca, memory_order_relaxed);
+	while(1){
+		e = &fila_log[pos % TAM_LOG];
+		if(atomic_load_explicit(&e->seq, memory_order_acquire) != pos + 1)
+			break;  // Nada publicado nesta posição
+		escreveEvento(e);
+		atomic_store_explicit(&e->seq, pos + TAM_LOG, memory_order_release);  // Libera a posição
+		pos++;
+		n++;
+	}
+	atomic_store_explicit(&log_cabeca, pos, memory_order_release);
+	if(n > 0) fflush(saida_log ? saida_log : stdout);
+	return n;
+}
+
+/*
+ * THREADLOG: Esvazia a fila periodicamente até o fim pedido
+ */
+void* threadLog(void *arg){
+	struct timespec pausa = {0, 1000000};  // 1 ms
+
+	(void)arg;
+	while(!atomic_load(&log_encerrar)){
+		if(consomeLog() == 0)
+			nanosleep(&pausa, NULL);
+	}
+	consomeLog();
+	return NULL;
+}
+
+/*
+ * INICIALOG: Prepara a fila e cria a thread de log
+ */
+void iniciaLog(){
+	unsigned int i;
+
+	for(i = 0; i < TAM_LOG; i++)
+		atomic_init(&fila_log[i].seq, i);
+	atomic_store(&log_cauda, 0);
+	atomic_store(&log_cabeca, 0);
+	atomic_store(&log_encerrar, 0);
+	inicio_log = relogio();
+	if(pthread_create(&thread_log, NULL, threadLog, NULL) == 0)
+		log_ativo = 1;
+}
+
+/*
+ * ESVAZIALOG: Espera a thread de log escrever tudo o que já foi enfileirado
+ * (usar antes de um printf direto para manter a ordem da saída)
+ */
+void esvaziaLog(){
+	struct timespec pausa = {0, 200000};  // 0,2 ms
+
+	if(!log_ativo) return;
+	while(atomic_load(&log_cabeca) != atomic_load(&log_cauda))
+		nanosleep(&pausa, NULL);
+	fflush(stdout);
+}
+
+/*
+ * ENCERRALOG: Escreve o restante, termina a thread e informa os descartes
+ */
+void encerraLog(){
+	unsigned long perdidos;
+
+	if(!log_ativo) return;
+	atomic_store(&log_encerrar, 1);
+	pthread_join(thread_log, NULL);
+	log_ativo = 0;
+
+	perdidos = atomic_load(&log_descartados);
+	if(perdidos > 0)
+		registraMensagem(LOG_AVISO, "\nLog: %lu eventos descartados (fila cheia)\n", perdidos);
+	if(saida_log != NULL){
+		fclose(saida_log);
+		saida_log = NULL;
+	}
+}
+
+/*
+ * LIMPATERMINAL: Limpa a tela só quando o log em texto vai para um terminal
+ */
+void limpaTerminal(){
+	esvaziaLog();
+	if(!log_json && (saida_log == NULL) && (nivel_log >= LOG_INFO) && isatty(STDOUT_FILENO))
+		printf("\e[H\e[2J");
+}
+
+// ============================================================================
+// VERIFICAÇÃO DIFERENCIAL DO DELTA
+// ============================================================================
+
+/*
+ * A cada intervalo_verificacao iterações (-d N; toda iteração com
+ * -DVERIFICA_INVARIANTES) o SA confere o movimento composto contra
+ * calcula_FO, a semântica de referência: a FO obtida por delta e, parcela
+ * por parcela, o delta de cada restrição. Na primeira divergência informa
+ * o movimento, ressincroniza a FO pela referência e passa a conferir toda
+ * iteração, então a divergência seguinte aponta o movimento exato (com N >
+ * 1 a primeira pode vir de um movimento anterior, desde a última conferência).
+ * 
+ * As conferências chamam calcula_FO, que também atualiza as estruturas
+ * usadas por geraViz: com a verificação ligada a trajetória do SA muda,
+ * mas não a correção da FO.
+ */
+long verificacoes = 0;   // Movimentos conferidos
+long divergencias = 0;   // Movimentos com delta diferente da referência
+
+/*
+ * DESCREVEMOVIMENTO: Texto do último movimento composto do avaliador
+ */
+void descreveMovimento(Avaliador *av, char *texto){
+	switch(av->mov_tipo){
+		case 0:
+			sprintf(texto, "Kempe (períodos %d e %d, sala %s)", av->mov_arg[0], av->mov_arg[1], sala[av->mov_arg[2]].nome);
+			break;
+		case 1:
+			sprintf(texto, "sala da disciplina (%s para a sala %s)", disc[av->mov_arg[0]].nome, sala[av->mov_arg[1]].nome);
+			break;
+		case 2:
+			sprintf(texto, "dia do professor (%s, dia %d para o dia %d)", prof[av->mov_arg[0]].nome, av->mov_arg[1], av->mov_arg[2]);
+			break;
+		case 3:
+			sprintf(texto, "troca de dias (%d e %d)", av->mov_arg[0], av->mov_arg[1]);
+			break;
+		default:
+			sprintf(texto, "nenhum (vizinhança sem candidato)");
+	}
+}
+
+/*
+ * VERIFICADELTA: Confere o movimento composto que levou antes a depois
+ * (depois.fo obtida por delta, av com os deltas por restrição)
+ * Retorna 1 se confere. Deixa as estruturas de calcula_FO com depois.
+ */
+int verificaDelta(Matriz antes, Matriz depois, Avaliador *av, long long iteracao){
+	int k, ok;
+	long long fo_antes, fo_depois, ref_antes[12];
+	char texto[SIZE * 3];
+
+	verificacoes++;
+	fo_antes = calcula_FO(antes);
+	memcpy(ref_antes, penalidades, sizeof(ref_antes));
+	fo_depois = calcula_FO(depois);
+
+	ok = (fo_depois == depois.fo);
+	for(k = 0; k < 12; k++)
+		if(penalidades[k] - ref_antes[k] != av->delta[k]) ok = 0;
+	if(ok) return 1;
+
+	divergencias++;
+	if(divergencias > 10) return 0;  // Só as primeiras são detalhadas
+	descreveMovimento(av, texto);
+	esvaziaLog();
+	printf("\nDIVERGÊNCIA na iteração %lld: fo por delta %lld, calcula_FO %lld (antes: %lld e %lld)",
+	       iteracao, depois.fo, fo_depois, antes.fo, fo_antes);
+	printf("\n  Movimento: %s", texto);
+	for(k = 0; k < 12; k++)
+		if(penalidades[k] - ref_antes[k] != av->delta[k])
+			printf("\n  R%d: delta %lld, referência %lld", k, av->delta[k], penalidades[k] - ref_antes[k]);
+	if(antes.fo != fo_antes)
+		printf("\n  A solução de partida já divergia: erro num movimento anterior.");
+	printf("\n");
+	return 0;
+}
+
+// ============================================================================
+// SINAIS: DESPEJO DA MELHOR SOLUÇÃO E PARADA LIMPA
+// ============================================================================
+
+/*
+ * SIGUSR1 pede a gravação da melhor solução do SA em <saida>.parcial.
+ * SIGINT/SIGTERM encerram a busca: o SA sai do laço, pula religação e
+ * polimento e a grade segue o caminho normal até salvaResultado (a grade
+ * seguinte não é construída). Um segundo SIGINT/SIGTERM encerra na hora.
+ * 
+ * Os sinais ficam bloqueados em todas as threads e uma thread dedicada os
+ * recebe com sigwait, só marcando os pedidos. O SA confere os pedidos a
+ * cada iteração; no despejo só copia a melhor grade para um buffer (sem
+ * esperar: se o buffer estiver ocupado, tenta na iteração seguinte) e a
+ * formatação e a escrita ficam com a thread gravadora.
+ * 
+ * A mesma thread mantém <saida>.melhor: a cada melhora o SA publica a
+ * melhor solução, no máximo uma vez a cada intervalo_incumbente segundos
+ * (melhoras dentro do intervalo saem na primeira publicação seguinte). O
+ * arquivo é sempre trocado por rename, então quem o lê durante a execução
+ * vê sempre uma grade completa.
+ */
+
+/*
+ * DESPEJO: Buffer duplo entre o SA (publica) e a thread gravadora
+ */
+typedef struct despejo{
+	pthread_mutex_t trava;
+	pthread_cond_t  aviso;
+	pthread_t thread;
+	Matriz publicada;     // Última cópia publicada pelo SA (protegida pela trava)
+	Matriz gravando;      // Cópia em gravação (só da thread gravadora)
+	int pendente;         // Destinos (DESPEJO_*) da cópia publicada ainda não gravada
+	int encerrar;         // Fim do SA: grava o pendente e termina
+	float T;              // Temperatura na publicação
+	double segundos;      // Tempo de busca na publicação
+}Despejo;
+
+Despejo despejo;
+
+/*
+ * ESPERASINAIS: Thread que recebe SIGUSR1, SIGINT e SIGTERM
+ */
+void* esperaSinais(void *arg){
+	sigset_t *conjunto = (sigset_t*) arg;
+	int sinal;
+
+	while(sigwait(conjunto, &sinal) == 0){
+		if(sinal == SIGUSR1)
+			atomic_store(&pedido_despejo, 1);
+		else if(atomic_exchange(&parar_busca, 1))
+			_exit(130);  // Segundo pedido de parada: sai sem salvar
+	}
+	return NULL;
+}
+
+/*
+ * INICIASINAIS: Bloqueia os sinais (herdado pelas threads criadas depois)
+ * e cria a thread que os recebe. Chamar antes de qualquer outra thread.
+ */
+void iniciaSinais(){
+	static sigset_t conjunto;
+	pthread_t thread;
+
+	sigemptyset(&conjunto);
+	sigaddset(&conjunto, SIGUSR1);
+	sigaddset(&conjunto, SIGINT);
+	sigaddset(&conjunto, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &conjunto, NULL);
+
+	if(pthread_create(&thread, NULL, esperaSinais, &conjunto) == 0)
+		pthread_detach(thread);
+}
+
+/*
+ * GRAVAGRADEPARCIAL: Grava FO, estatísticas e a grade (formato de
+ * salvaResultado) em arquivo temporário e renomeia: quem lê o destino
+ * nunca vê um arquivo pela metade. Só lê dados da instância (constantes
+ * durante o SA), então roda fora da thread da busca.
+ */
+void gravaGradeParcial(Matriz m, float temp, double segundos, char *arquivo){
+	char tmp[SIZE * 2 + 8];
+	FILE *fp;
+	int i, j;
+
+	if(arquivo[0] == '\0') return;  // Destino não definido
+
+	sprintf(tmp, "%s.tmp", arquivo);
+	fp = fopen(tmp, "w");
+	if(!fp) return;
+
+	fprintf(fp, "Nome: %s\n", nome);
+	fprintf(fp, "Função Objetivo (FO): %lld\n", m.fo);
+	fprintf(fp, "Violações graves: %lld\n", m.fo / 1000000);  // Peso 1000000 por violação grave
+	fprintf(fp, "Penalidade leve: %lld\n", m.fo % 1000000);
+	fprintf(fp, "Limite inferior: %lld (gap: %lld)\n", limite_inferior, m.fo - limite_inferior);
+	fprintf(fp, "Temperatura: %f\n", temp);
+	fprintf(fp, "Tempo de busca: %.3fs\n\n", segundos);
+
+	fprintf(fp, "[Dia/Per");
+	for(j = 0; j < salas; j++)
+		fprintf(fp, "|%s\t", sala[j].nome);
+	fprintf(fp, "|]\n");
+	for(i = 0; i < total_periodos; i++){
+		fprintf(fp, "[ %d, %d\t", i / periodos_dia, i % periodos_dia);
+		for(j = 0; j < salas; j++){
+			if(m.n[i][j] < 0)
+				fprintf(fp, "|-----\t");
+			else
+				fprintf(fp, "|%s\t", disc[m.n[i][j]].nome);
+		}
+		fprintf(fp, "|]\n");
+	}
+
+	if(fclose(fp) == 0)
+		rename(tmp, arquivo);
+	else
+		remove(tmp);
+}
+
+/*
+ * GRAVADESPEJOS: Thread gravadora. Troca a cópia publicada pela sua (o SA
+ * segura a trava só durante a cópia) e grava fora da trava.
+ */
+void* gravaDespejos(void *arg){
+	Matriz aux;
+	float temp;
+	double segundos;
+	int destinos;
+
+	(void)arg;
+	pthread_mutex_lock(&despejo.trava);
+	while(1){
+		while(!despejo.pendente && !despejo.encerrar)
+			pthread_cond_wait(&despejo.aviso, &despejo.trava);
+		if(!despejo.pendente) break;
+
+		aux = despejo.gravando;
+		despejo.gravando = despejo.publicada;
+		despejo.publicada = aux;
+		temp = despejo.T;
+		segundos = despejo.segundos;
+		destinos = despejo.pendente;
+		despejo.pendente = 0;
+		pthread_mutex_unlock(&despejo.trava);
+
+		if(destinos & DESPEJO_INCUMBENTE)
+			gravaGradeParcial(despejo.gravando, temp, segundos, arquivo_incumbente);
+		if(destinos & DESPEJO_PARCIAL){
+			gravaGradeParcial(despejo.gravando, temp, segundos, arquivo_despejo);
+			registraMensagem(LOG_INFO, "\nMelhor solução gravada em %s (fo = %lld)", arquivo_despejo, despejo.gravando.fo);
+		}
+
+		pthread_mutex_lock(&despejo.trava);
+	}
+	pthread_mutex_unlock(&despejo.trava);
+	return NULL;
 }
 
 /*
- * ALTERA_PARAMETROS: Função placeholder para ajuste dinâmico de parâmetros
+ * INICIADESPEJO: Buffers da instância atual e thread gravadora (por SA)
  */
-void altera_parametros(){
-	// Não implementada
+void iniciaDespejo(){
+	pthread_mutex_init(&despejo.trava, NULL);
+	pthread_cond_init(&despejo.aviso, NULL);
+	despejo.publicada = criaMatriz();
+	despejo.gravando = criaMatriz();
+	despejo.pendente = 0;
+	despejo.encerrar = 0;
+	pthread_create(&despejo.thread, NULL, gravaDespejos, NULL);
+}
+
+/*
+ * PUBLICADESPEJO: Entrega uma cópia de m à thread gravadora, para os
+ * destinos indicados (DESPEJO_*), sem bloquear. Uma cópia ainda não
+ * gravada é substituída e os destinos se acumulam.
+ * Retorna 0 se a gravadora estava com a trava (tente de novo depois).
+ */
+int publicaDespejo(Matriz m, float temp, double segundos, int destinos){
+	if(pthread_mutex_trylock(&despejo.trava) != 0)
+		return 0;
+	copiaMatriz(&despejo.publicada, m);
+	despejo.T = temp;
+	despejo.segundos = segundos;
+	despejo.pendente |= destinos;
+	pthread_cond_signal(&despejo.aviso);
+	pthread_mutex_unlock(&despejo.trava);
+	return 1;
+}
+
+/*
+ * ENCERRADESPEJO: Grava o que estiver pendente e termina a thread gravadora
+ */
+void encerraDespejo(){
+	pthread_mutex_lock(&despejo.trava);
+	despejo.encerrar = 1;
+	pthread_cond_signal(&despejo.aviso);
+	pthread_mutex_unlock(&despejo.trava);
+	pthread_join(despejo.thread, NULL);
+
+	liberaMatriz(despejo.publicada);
+	liberaMatriz(despejo.gravando);
+	pthread_mutex_destroy(&despejo.trava);
+	pthread_cond_destroy(&despejo.aviso);
+}
+
+// ============================================================================
+// TRAÇO DE CONVERGÊNCIA
+// ============================================================================
+
+/*
+ * Guarda em memória toda melhora da melhor solução e uma amostra por passo
+ * de temperatura (T, atual.fo e taxa de aceitação), para as curvas de
+ * desempenho ao longo do tempo de cada execução. Cada registro é codificado
+ * em relação ao anterior: tempo, iteração e FO viram diferenças em inteiros
+ * de tamanho variável (7 bits por byte, zigzag para os negativos) e T vai
+ * em 4 bytes; uma melhora típica ocupa uns 10 bytes.
+ * 
+ * Registro: tipo (1 byte, TRACO_MELHORA ou TRACO_AMOSTRA), Δtempo em ms de
+ * relógio desde o início do SA, Δiteração, Δfo (em relação ao último registro
+ * do mesmo tipo), T (float) e, na amostra, a aceitação do passo em
+ * milésimos. A parte grave e a leve saem da FO (peso 1000000 por violação
+ * grave) na gravação.
+ * 
+ * Arquivo binário (<saida>.traco): "SATRC1" e dois bytes zero, número de
+ * registros e de bytes (long long) e os bytes do traço. Em CSV
+ * (<saida>.traco.csv) os registros saem decodificados.
+ */
+typedef struct traco{
+	unsigned char *dados;            // Registros codificados
+	size_t tam, cap;                 // Bytes usados e alocados
+	long long registros;             // Registros no traço
+	long long iteracao;              // Iterações do SA até agora
+	long long ult_ms, ult_iteracao;  // Base das diferenças do próximo registro
+	long long ult_fo[2];             // Última FO de cada tipo de registro
+}Traco;
+
+Traco traco = {NULL, 0, 0, 0, 0, 0, 0, {0, 0}};
+int  formato_traco = TRACO_BINARIO;  // TRACO_NENHUM, TRACO_BINARIO ou TRACO_CSV
+char arquivo_traco[SIZE * 2] = "";   // Destino do traço da grade em construção
+
+/*
+ * REINICIATRACO: Esvazia o traço (mantém a memória alocada)
+ */
+void reiniciaTraco(){
+	traco.tam = 0;
+	traco.registros = 0;
+	traco.iteracao = 0;
+	traco.ult_ms = 0;
+	traco.ult_iteracao = 0;
+	traco.ult_fo[0] = traco.ult_fo[1] = 0;
+}
+
+/*
+ * RESERVATRACO: Garante espaço para mais n bytes (dobra a capacidade)
+ */
+void reservaTraco(size_t n){
+	if(traco.tam + n <= traco.cap) return;
+	if(traco.cap == 0) traco.cap = 4096;
+	while(traco.tam + n > traco.cap)
+		traco.cap *= 2;
+	traco.dados = (unsigned char*) realloc(traco.dados, traco.cap);
+}
+
+/*
+ * VARINTTRACO: Acrescenta x em 7 bits por byte (bit alto = continua)
+ */
+void varintTraco(unsigned long long x){
+	while(x >= 0x80){
+		traco.dados[traco.tam++] = (unsigned char)(x | 0x80);
+		x >>= 7;
+	}
+	traco.dados[traco.tam++] = (unsigned char) x;
+}
+
+/*
+ * REGISTRATRACO: Acrescenta um registro (aceitacao só vale na amostra)
+ */
+void registraTraco(int tipo, long long ms, float temp, long long fo, int aceitacao){
+	long long dfo;
+
+	if(formato_traco == TRACO_NENHUM) return;
+	reservaTraco(1 + 4 * 10 + sizeof(float));  // Pior caso de um registro
+
+	if(ms < traco.ult_ms) ms = traco.ult_ms;
+	dfo = fo - traco.ult_fo[tipo];
+
+	traco.dados[traco.tam++] = (unsigned char) tipo;
+	varintTraco(ms - traco.ult_ms);
+	varintTraco(traco.iteracao - traco.ult_iteracao);
+	varintTraco(((unsigned long long) dfo << 1) ^ (unsigned long long)(dfo >> 63));  // Zigzag
+	memcpy(traco.dados + traco.tam, &temp, sizeof(float));
+	traco.tam += sizeof(float);
+	if(tipo == TRACO_AMOSTRA)
+		varintTraco(aceitacao);
+
+	traco.ult_ms = ms;
+	traco.ult_iteracao = traco.iteracao;
+	traco.ult_fo[tipo] = fo;
+	traco.registros++;
+}
+
+/*
+ * LEVARINTTRACO: Decodifica o inteiro que começa em dados[*i]
+ */
+unsigned long long leVarintTraco(unsigned char *dados, size_t *i){
+	unsigned long long x = 0;
+	int desl = 0;
+
+	while(dados[*i] & 0x80){
+		x |= (unsigned long long)(dados[(*i)++] & 0x7f) << desl;
+		desl += 7;
+	}
+	x |= (unsigned long long) dados[(*i)++] << desl;
+	return x;
+}
+
+/*
+ * GRAVATRACO: Grava o traço no formato escolhido (fim de cada SA)
+ */
+void gravaTraco(){
+	FILE *fp;
+	size_t i = 0;
+	long long ms = 0, iteracao = 0, registros;
+	unsigned long long z;
+	int tipo, aceitacao;
+	long long fo[2] = {0, 0};
+	float temp;
+
+	if((formato_traco == TRACO_NENHUM) || (arquivo_traco[0] == '\0')) return;
+	fp = fopen(arquivo_traco, (formato_traco == TRACO_CSV) ? "w" : "wb");
+	if(!fp){
+		printf("\nERRO! - Não foi possível gravar o traço %s", arquivo_traco);
+		return;
+	}
+
+	if(formato_traco == TRACO_BINARIO){
+		registros = (long long) traco.tam;
+		fwrite("SATRC1\0\0", 8, 1, fp);
+		fwrite(&traco.registros, sizeof(long long), 1, fp);
+		fwrite(&registros, sizeof(long long), 1, fp);
+		if(traco.tam > 0)
+			fwrite(traco.dados, traco.tam, 1, fp);
+	}
+	else{
+		fprintf(fp, "tipo,tempo_ms,iteracao,T,fo,graves,leve,aceitacao\n");
+		while(i < traco.tam){
+			tipo = traco.dados[i++];
+			ms += leVarintTraco(traco.dados, &i);
+			iteracao += leVarintTraco(traco.dados, &i);
+			z = leVarintTraco(traco.dados, &i);
+			fo[tipo] += (long long)(z >> 1) ^ -(long long)(z & 1);
+			memcpy(&temp, traco.dados + i, sizeof(float));
+			i += sizeof(float);
+			aceitacao = (tipo == TRACO_AMOSTRA) ? (int) leVarintTraco(traco.dados, &i) : 0;
+
+			if(tipo == TRACO_AMOSTRA)
+				fprintf(fp, "amostra,%lld,%lld,%g,%lld,%lld,%lld,%.3f\n", ms, iteracao, temp,
+				        fo[tipo], fo[tipo] / 1000000, fo[tipo] % 1000000, aceitacao / 1000.0);
+			else
+				fprintf(fp, "melhora,%lld,%lld,%g,%lld,%lld,%lld,\n", ms, iteracao, temp,
+				        fo[tipo], fo[tipo] / 1000000, fo[tipo] % 1000000);
+		}
+	}
+	fclose(fp);
+	printf("\nTraço de convergência: %lld registros, %zu bytes em %s", traco.registros, traco.tam, arquivo_traco);
+}
+
+// ============================================================================
+// REAQUECIMENTO POR ESTAGNAÇÃO
+// ============================================================================
+
+/*
+ * ESTAGNACAO: Janela de medição do progresso do SA
+ * A cada param.janela passos de temperatura, a janela estagnou se não houve
+ * nova melhor solução nela e a taxa de aceitação das pioras caiu abaixo de
+ * param.aceitacao_minima (movimentos laterais, delta = 0, não contam: em
+ * platôs eles seguem aceitos mesmo com a busca congelada). O nível do
+ * reaquecimento vem dos últimos AMOSTRA_DELTAS deltas de piora propostos
+ * que não criam violação grave: aceitar estas é recomeçar do zero, papel
+ * dos reinícios (ver REINÍCIOS DO SA).
+ */
+typedef struct estagnacao{
+	int passos;                   // Passos de temperatura na janela atual
+	int pioras;                   // Vizinhos piores propostos na janela atual
+	int subidas;                  // Vizinhos piores aceitos na janela atual
+	int amostras;                 // Deltas de piora leve registrados desde o início
+	long long fo_reaquecimento;   // melhor.fo no último reaquecimento
+	int deltas[AMOSTRA_DELTAS];   // Últimos deltas de piora leve (anel)
+}Estagnacao;
+
+/*
+ * REGISTRADELTA: Conta uma piora proposta (delta já amplificado) e, se ela
+ * não cria violação grave, guarda o delta na amostra
+ */
+static inline void registraDelta(Estagnacao *e, long long delta){
+	e->pioras++;
+	if(delta < (500000 << param.amplificacao)){  // Menos de meia violação grave
+		e->deltas[e->amostras % AMOSTRA_DELTAS] = (int)delta;
+		e->amostras++;
+	}
+}
+
+/*
+ * FECHAJANELA: Conta um passo de temperatura na janela
+ * Retorna 1 se a janela completou param.janela passos sem nova melhor
+ * solução (sem_melhora = passos desde a última) e com aceitação das pioras
+ * abaixo do mínimo. A janela recomeça a cada param.janela passos.
+ */
+int fechaJanela(Estagnacao *e, int sem_melhora){
+	int estagnou;
+
+	if(++e->passos < param.janela) return 0;
+
+	estagnou = (sem_melhora >= param.janela) && (e->amostras > 0) && (e->pioras > 0) &&
+	           (e->subidas < param.aceitacao_minima * e->pioras);
+	e->passos = e->pioras = e->subidas = 0;
+	return estagnou;
+}
+
+/*
+ * TEMPERATURAREAQUECIMENTO: Temperatura em que a piora mediana da amostra
+ * é aceita com chance param.aceitacao_reaquecimento
+ * (exp(-mediana / T) = aceitacao => T = mediana / -ln(aceitacao)),
+ * limitada a [T, Tmax]: reaquecer nunca esfria nem passa da inicial.
+ */
+float temperaturaReaquecimento(Estagnacao *e, float T, float Tmax){
+	int v[AMOSTRA_DELTAS];
+	int n = (e->amostras < AMOSTRA_DELTAS) ? e->amostras : AMOSTRA_DELTAS;
+	int i, j, x;
+	float nova;
+
+	// Ordenação por inserção: só roda a cada reaquecimento
+	for(i = 0; i < n; i++){
+		x = e->deltas[i];
+		for(j = i; (j > 0) && (v[j - 1] > x); j--)
+			v[j] = v[j - 1];
+		v[j] = x;
+	}
+	nova = v[n / 2] / -log(param.aceitacao_reaquecimento);
+	if(nova > Tmax) nova = Tmax;
+	return (nova > T) ? nova : T;
+}
+
+// ============================================================================
+// CHECKPOINT E RETOMADA DO SA
+// ============================================================================
+
+/*
+ * ESTADOSA: Variáveis locais do SA que entram no checkpoint
+ */
+typedef struct estadoSA{
+	float T, Tinicial, Tfinal, alpha;  // Temperaturas e resfriamento
+	float Tempo;                       // Segundos exibidos no progresso
+	int maxIteracoes;                  // Iterações por temperatura
+	int hora, minuto;                  // Tempo exibido no progresso
+	int reaquecimento;                 // Reaquecimentos feitos
+	int fim_forcado;                   // Contador de estagnação
+	long long r2_atual;                // Penalidade R2 da solução atual
+	int passos;                        // Passos de temperatura concluídos
+	int concluido;                     // 1 = SA terminado (após polimento)
+	double decorrido_real;             // Segundos de relógio até o checkpoint (prazo_sa e traço)
+	Estagnacao estagnacao;             // Janela e amostra de deltas do reaquecimento
+}EstadoSA;
+
+/*
+ * CABECALHOCHECKPOINT: Identifica a instância do checkpoint
+ */
+typedef struct cabecalhoCheckpoint{
+	char magica[8];        // "SACKPT7"
+	char nome[SIZE];       // Nome da instância
+	int disciplinas, salas, total_periodos, total_aulas, professores, cursos;
+}CabecalhoCheckpoint;
+
+/*
+ * PREENCHECABECALHO: Cabeçalho esperado para a instância carregada
+ */
+void preencheCabecalho(CabecalhoCheckpoint *c){
+	memset(c, 0, sizeof(CabecalhoCheckpoint));
+	strcpy(c->magica, "SACKPT7");
+	strcpy(c->nome, nome);
+	c->disciplinas = disciplinas;
+	c->salas = salas;
+	c->total_periodos = total_periodos;
+	c->total_aulas = total_aulas;
+	c->professores = professores;
+	c->cursos = cursos;
+}
+
+/*
+ * BLOCOCHECKPOINT: Grava (grava = 1) ou lê um bloco de bytes
+ * Retorna 1 se todo o bloco foi transferido.
+ */
+int blocoCheckpoint(FILE *fp, int grava, void *dados, size_t tamanho){
+	if(tamanho == 0) return 1;
+	if(grava) return fwrite(dados, tamanho, 1, fp) == 1;
+	return fread(dados, tamanho, 1, fp) == 1;
+}
+
+/*
+ * LINHASCHECKPOINT: Transfere uma matriz de int linha a linha
+ */
+int linhasCheckpoint(FILE *fp, int grava, int **m, int linhas, int colunas){
+	int i, ok = 1;
+	for(i = 0; (i < linhas) && ok; i++)
+		ok = blocoCheckpoint(fp, grava, m[i], colunas * sizeof(int));
+	return ok;
+}
+
+/*
+ * GRADECHECKPOINT: Transfere uma solução (fo, hash e aula de cada célula)
+ * Na leitura, n e pos são reconstruídos a partir das aulas.
+ */
+int gradeCheckpoint(FILE *fp, int grava, Matriz *m){
+	int i, j, ok;
+
+	ok = blocoCheckpoint(fp, grava, &m->fo, sizeof(long long)) &&
+	     blocoCheckpoint(fp, grava, &m->hash, sizeof(unsigned long long)) &&
+	     linhasCheckpoint(fp, grava, m->a, total_periodos, salas);
+	if(!ok || grava) return ok;
+
+	setVetor(m->pos, total_aulas, -1);
+	for(i = 0; i < total_periodos; i++){
+		for(j = 0; j < salas; j++){
+			m->n[i][j] = (m->a[i][j] == -1) ? -1 : aula_disc[m->a[i][j]];
+			if(m->a[i][j] != -1)
+				m->pos[m->a[i][j]] = i * salas + j;
+		}
+	}
+	return 1;
+}
+
+/*
+ * TRANSFERECHECKPOINT: Grava ou lê o estado completo da busca
+ * - escalares do SA, gerador aleatório e histórico de soluções
+ * - parâmetros do SA (param) e intervalo da verificação diferencial: a
+ *   retomada segue com os da execução interrompida, não com os de -p/-P/-T
+ * - soluções atual e melhor, memória de estados (tabu) e conjunto elite
+ * - estruturas da última calcula_FO, que guiam os movimentos de geraViz
+ * - traço de convergência
+ */
+int transfereCheckpoint(FILE *fp, int grava, EstadoSA *e, Matriz *atual, Matriz *melhor, Tabu *tabu){
+	CabecalhoCheckpoint c, lido;
+	ParametrosSA atuais = param;
+	int i, ok;
+
+	preencheCabecalho(&c);
+	if(grava) ok = blocoCheckpoint(fp, 1, &c, sizeof(c));
+	else ok = blocoCheckpoint(fp, 0, &lido, sizeof(lido)) && (memcmp(&c, &lido, sizeof(c)) == 0);
+	if(!ok) return 0;
+
+	ok = blocoCheckpoint(fp, grava, e, sizeof(EstadoSA)) &&
+	     blocoCheckpoint(fp, grava, &param, sizeof(ParametrosSA)) &&
+	     blocoCheckpoint(fp, grava, &intervalo_verificacao, sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, &estado_rng, sizeof(estado_rng)) &&
+	     blocoCheckpoint(fp, grava, mat_solucao_tempo, sizeof(mat_solucao_tempo)) &&
+	     blocoCheckpoint(fp, grava, &aux_mat, sizeof(aux_mat)) &&
+	     gradeCheckpoint(fp, grava, atual) &&
+	     gradeCheckpoint(fp, grava, melhor);
+
+	// Memória de estados recentes (anel e tabela)
+	ok = ok && blocoCheckpoint(fp, grava, &tabu->pos, sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, &tabu->ocupados, sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, &tabu->remocoes, sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, &tabu->revisitas, sizeof(long)) &&
+	     blocoCheckpoint(fp, grava, &tabu->proibidos, sizeof(long)) &&
+	     blocoCheckpoint(fp, grava, tabu->recentes, tabu->duracao * sizeof(unsigned long long)) &&
+	     blocoCheckpoint(fp, grava, tabu->tab_hash, (tabu->mascara + 1) * sizeof(unsigned long long)) &&
+	     blocoCheckpoint(fp, grava, tabu->tab_cont, (tabu->mascara + 1) * sizeof(int));
+
+	// Conjunto elite
+	ok = ok && blocoCheckpoint(fp, grava, &elite->quantidade, sizeof(int)) &&
+	     (elite->quantidade >= 0) && (elite->quantidade <= elite->capacidade);
+	for(i = 0; ok && (i < elite->quantidade); i++)
+		ok = gradeCheckpoint(fp, grava, &elite->sol[i]);
+
+	// Estruturas da última calcula_FO
+	ok = ok && blocoCheckpoint(fp, grava, restricoes_violadas, sizeof(restricoes_violadas)) &&
+	     blocoCheckpoint(fp, grava, penalidades, sizeof(penalidades)) &&
+	     blocoCheckpoint(fp, grava, aux_mov_r21, disciplinas * sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, aux_mov_r22, disciplinas * sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, aux_mov_r4, disciplinas * sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, aux_mov_r5, disciplinas * sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, aux_mov_r8, total_periodos * sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, aux_mov_r9, professores * sizeof(int)) &&
+	     blocoCheckpoint(fp, grava, r8, disciplinas * sizeof(int)) &&
+	     linhasCheckpoint(fp, grava, aux_mov_r6, total_periodos, salas) &&
+	     linhasCheckpoint(fp, grava, aux_mov_r7, disciplinas, 2) &&
+	     linhasCheckpoint(fp, grava, aux_mov_r10, disciplinas, 2) &&
+	     linhasCheckpoint(fp, grava, r21, total_periodos, professores) &&
+	     linhasCheckpoint(fp, grava, r22, total_periodos, cursos) &&
+	     linhasCheckpoint(fp, grava, r5, disciplinas, dias) &&
+	     linhasCheckpoint(fp, grava, r9, professores, dias) &&
+	     linhasCheckpoint(fp, grava, r11, dias, disciplinas);
+
+	// Traço de convergência (tamanho e bytes codificados)
+	ok = ok && blocoCheckpoint(fp, grava, &traco.registros, sizeof(long long)) &&
+	     blocoCheckpoint(fp, grava, &traco.iteracao, sizeof(long long)) &&
+	     blocoCheckpoint(fp, grava, &traco.ult_ms, sizeof(long long)) &&
+	     blocoCheckpoint(fp, grava, &traco.ult_iteracao, sizeof(long long)) &&
+	     blocoCheckpoint(fp, grava, traco.ult_fo, sizeof(traco.ult_fo)) &&
+	     blocoCheckpoint(fp, grava, &traco.tam, sizeof(size_t));
+	if(ok && !grava){
+		i = traco.tam;
+		traco.tam = 0;
+		reservaTraco(i);
+		traco.tam = i;
+	}
+	ok = ok && blocoCheckpoint(fp, grava, traco.dados, traco.tam);
+	if(ok && !grava && (memcmp(&atuais, &param, sizeof(ParametrosSA)) != 0))
+		printf("\nRetomada com os parâmetros do SA gravados no checkpoint (diferem dos atuais)");
+	return ok;
+}
+
+/*
+ * SALVACHECKPOINT: Grava o estado da busca em arquivo temporário e o
+ * renomeia, para que um processo interrompido nunca deixe checkpoint pela metade
+ */
+void salvaCheckpoint(EstadoSA *e, Matriz *atual, Matriz *melhor, Tabu *tabu){
+	char temporario[SIZE * 2 + 8];
+	FILE *fp;
+
+	if(arquivo_checkpoint[0] == '\0') return;
+	sprintf(temporario, "%s.tmp", arquivo_checkpoint);
+	fp = fopen(temporario, "wb");
+	if(!fp){
+		printf("\nERRO! - Não foi possível gravar o checkpoint %s", temporario);
+		return;
+	}
+	if(!transfereCheckpoint(fp, 1, e, atual, melhor, tabu) | (fclose(fp) != 0)){
+		printf("\nERRO! - Falha ao gravar o checkpoint %s", temporario);
+		remove(temporario);
+		return;
+	}
+	rename(temporario, arquivo_checkpoint);
+}
+
+/*
+ * EXISTECHECKPOINT: 1 se a retomada está ligada e há checkpoint desta instância
+ */
+int existeCheckpoint(){
+	CabecalhoCheckpoint c, lido;
+	FILE *fp;
+	int ok;
+
+	if(!retomar || (arquivo_checkpoint[0] == '\0')) return 0;
+	fp = fopen(arquivo_checkpoint, "rb");
+	if(!fp) return 0;
+	preencheCabecalho(&c);
+	ok = blocoCheckpoint(fp, 0, &lido, sizeof(lido)) && (memcmp(&c, &lido, sizeof(c)) == 0);
+	fclose(fp);
+	if(!ok)
+		printf("\nCheckpoint %s é de outra instância: ignorado.\n", arquivo_checkpoint);
+	return ok;
+}
+
+/*
+ * CARREGACHECKPOINT: Restaura o estado da busca do checkpoint da instância
+ * Retorna 1 se restaurou (use existeCheckpoint antes: falha aqui é arquivo
+ * truncado e deixa o estado pela metade).
+ */
+int carregaCheckpoint(EstadoSA *e, Matriz *atual, Matriz *melhor, Tabu *tabu){
+	FILE *fp;
+	int ok;
+
+	fp = fopen(arquivo_checkpoint, "rb");
+	if(!fp) return 0;
+	ok = transfereCheckpoint(fp, 0, e, atual, melhor, tabu);
+	fclose(fp);
+	return ok;
 }
 
 // ============================================================================
 // ALGORITMO SIMULATED ANNEALING
 // ============================================================================
 
+/*
+ * LIMITEATINGIDO: 1 se a FO já está no limite inferior e a busca pode parar
+ * 
+ * Uma FO abaixo do limite prova que ele está errado: a busca deixa de
+ * parar nele (o gap continua sendo exibido, negativo).
+ */
+int limiteAtingido(long long fo){
+	if(!limite_valido) return 0;
+	if(fo < limite_inferior){
+		registraMensagem(LOG_AVISO, "\nFO %lld abaixo do limite inferior %lld: limite ignorado\n", fo, limite_inferior);
+		limite_valido = 0;
+		return 0;
+	}
+	return fo == limite_inferior;
+}
+
 /*
  * SA: Implementação do Simulated Annealing
  * 
@@ -1635,142 +5058,268 @@ void altera_parametros(){
  *    - Se melhor: aceita
  *    - Se pior: aceita com probabilidade exp(-delta/T)
  * 3. Reduz temperatura (T = T * alpha)
- * 4. Repete até T < T_final ou solução ótima
+ * 4. Repete até T < T_final ou até atingir o limite inferior (ótimo provado)
  * 
  * PARÂMETROS:
  * - T_inicial: Temperatura inicial (exploração)
  * - T_final: Temperatura final (refinamento)
  * - alpha: Taxa de resfriamento (0.93-0.995)
  * - maxIteracoes: Iterações por temperatura
+ * (valores em param: padrão ou lidos de arquivo com -p)
  * 
  * TÉCNICAS ESPECIAIS:
- * - Reaquecimento: Aumenta T quando estagnado
+ * - Reaquecimento: sem melhora e com aceitação abaixo de param.aceitacao_minima
+ *   por param.janela passos, T volta ao nível em que a piora mediana recente
+ *   é aceita com chance param.aceitacao_reaquecimento (quantas vezes couber
+ *   em prazo_sa; sem prazo, enquanto cada reaquecimento achar nova melhor)
  * - Ajuste dinâmico: Varia parâmetros conforme T
- * - Amplificação delta: Multiplica diferença por 4
+ * - Amplificação delta: Multiplica diferença por 4 (param.amplificacao)
+ * - Movimentos compostos: Kempe (sem conflitos R2), sala única por disciplina (R8),
+ *   dia do professor e troca de dias (R9), avaliados com delta incremental
+ * - Polimento final: primeira melhora em blocos circulares de células (em
+ *   paralelo) até o ótimo local ou o fim de prazo_sa
+ * - Memória de estados (hash de Zobrist): conta ciclos e, com param.tabu,
+ *   proíbe voltar aos últimos DURACAO_TABU estados aceitos
+ * - Conjunto elite: soluções distintas guardadas ao fim de cada temperatura,
+ *   religadas entre si (path relinking) antes do polimento
+ * - Checkpoint a cada INTERVALO_CHECKPOINT passos de temperatura; com
+ *   retomar = 1 continua do checkpoint exatamente como a execução original
  */
 Matriz SA(Matriz inicial){
 	// Aloca estruturas para soluções
 	Matriz atual = criaMatriz();
 	Matriz melhor = criaMatriz();
 	Matriz viz = criaMatriz();
+	Avaliador *av = criaAvaliador();  // Avaliação incremental dos movimentos compostos
+	Tabu *tabu = criaTabu(DURACAO_TABU);  // Estados aceitos recentes (ciclos/tabu)
 
-	clock_t inicio, fim;  // Para medir tempo
+	double decorrido;     // Segundos de relógio desde o início
 
-	float Tempo, Temp_reaquecimento;
+	float Tempo;
 	int i, delta, hora = 0, minuto = 0;
-	int reaquecimento = 1;       // Contador de reaquecimentos
+	long long variacao;          // viz.fo - atual.fo amplificada
+	int reaquecimento = 0;       // Reaquecimentos feitos (com prazo_sa, sem limite; sem
+	                             // prazo, o primeiro e os seguintes só se o anterior
+	                             // achou nova melhor)
 	int fim_forcado = 0;         // Contador de iterações sem melhora
+	long long r2_atual, r2_viz;  // Penalidade de conflitos (R2) da atual e da vizinha
+	long long fo_antes;          // melhor.fo antes da religação e do polimento
+	int passos = 0;              // Passos de temperatura concluídos
+	int aceitos;                 // Vizinhos aceitos no passo (traço de convergência)
+	int incumbente_novo = 0;     // Melhora ainda não publicada em <saida>.melhor
+	int fim_pedido = 0;          // Prazo esgotado ou grade viável (parar_se_viavel)
+	double ultima_gravacao;      // Relógio da última publicação da melhor solução
+	double inicio_real = relogio();  // Início pelo relógio (prazo_sa)
+	double limite;                   // Fim do prazo pelo relógio (0 = sem prazo)
+	EstadoSA estado;             // Estado gravado nos checkpoints
+	Estagnacao est = {0};        // Janela de estagnação e amostra de deltas
+
+	Tempo = 0;
+	estado.concluido = 0;
 
 	// ========================================================================
-	// INICIALIZAÇÃO DOS PARÂMETROS
+	// RETOMADA: restaura o estado completo do último checkpoint
 	// ========================================================================
-	
-	Tinicial = 1000000;          // Temperatura inicial muito alta
-	Tfinal = 0.00001;            // Temperatura final muito baixa
-	Temp_reaquecimento = Tfinal * 10;  // Limiar para reaquecimento
 
-	inicio = clock();            // Marca tempo inicial
+	if(existeCheckpoint()){
+		if(!carregaCheckpoint(&estado, &atual, &melhor, tabu)){
+			printf("\nERRO! - Checkpoint %s truncado.\n", arquivo_checkpoint);
+			exit(1);
+		}
+		T = estado.T;
+		Tinicial = estado.Tinicial;
+		Tfinal = estado.Tfinal;
+		alpha = estado.alpha;
+		Tempo = estado.Tempo;
+		maxIteracoes = estado.maxIteracoes;
+		hora = estado.hora;
+		minuto = estado.minuto;
+		reaquecimento = estado.reaquecimento;
+		fim_forcado = estado.fim_forcado;
+		r2_atual = estado.r2_atual;
+		passos = estado.passos;
+		est = estado.estagnacao;
+		inicio_real = relogio() - estado.decorrido_real;
+		printf("\nRetomando de %s: passo %d, T = %f, melhor.fo = %lld%s\n", arquivo_checkpoint,
+		       passos, T, melhor.fo, estado.concluido ? " (concluído)" : "");
+	}
+	else{
+		// ====================================================================
+		// INICIALIZAÇÃO DOS PARÂMETROS
+		// ====================================================================
+		
+		Tinicial = param.Tinicial;   // Temperatura inicial muito alta
+		Tfinal = param.Tfinal;       // Temperatura final muito baixa
+
+		inicio_real = relogio();     // Marca tempo inicial
 
-	copiaMatriz(&atual, inicial);    // Copia solução inicial
-	copiaMatriz(&melhor, atual);     // Melhor = inicial
+		copiaMatriz(&atual, inicial);    // Copia solução inicial
+		copiaMatriz(&melhor, atual);     // Melhor = inicial
+		atual.fo = calcula_FO(atual);
+		atual.hash = calculaHash(atual);
+		r2_atual = penalidades[2];
+		registraEstado(tabu, atual.hash);
 
-	T = Tinicial;                // Começa na temperatura inicial
+		T = (temperatura_partida > 0) ? temperatura_partida : Tinicial;  // Começa na temperatura inicial
+
+		reiniciaTraco();
+		registraTraco(TRACO_MELHORA, 0, T, melhor.fo, 0);
+	}
 
 	// ========================================================================
 	// LOOP PRINCIPAL DO SIMULATED ANNEALING
 	// ========================================================================
 	
-	while ((T > Tfinal) && (melhor.fo > 0) && (fim_forcado < 8000)){
+	iniciaDespejo();  // Thread gravadora (SIGUSR1 e melhor solução)
+	publicaDespejo(melhor, T, relogio() - inicio_real, DESPEJO_INCUMBENTE);
+	ultima_gravacao = relogio();
+	if(parar_se_viavel && (melhor.fo >= 0) && (melhor.fo < 1000000))
+		fim_pedido = 1;  // Já começa sem violações graves
+
+	// Checkpoint de um SA já concluído (por qualquer critério, prazo inclusive):
+	// não há o que recozer, a retomada segue para a próxima grade
+	while ((T > Tfinal) && !limiteAtingido(melhor.fo) && (fim_forcado < param.estagnacao) &&
+	       !atomic_load(&parar_busca) && !fim_pedido && !estado.concluido){
+		INICIO_FASE(FASE_PASSO_SA);
 		fim_forcado++;  // Incrementa contador de estagnação
 		
 		// ====================================================================
 		// AJUSTE DINÂMICO DE PARÂMETROS baseado na temperatura
 		// ====================================================================
 		
-		if(T > 1000){
-			// Temperatura MUITO ALTA: Exploração rápida
-			maxIteracoes = 600;
-			alpha = 0.98;    // Resfriamento mais rápido
-		}
-		else if(T > 100){
-			// Temperatura ALTA: Exploração moderada
-			maxIteracoes = 800;
-			alpha = 0.97;
-		}
-		else if(T > 10){
-			// Temperatura MÉDIA: Balanceamento
-			maxIteracoes = 1000;
-			alpha = 0.98;
-		}
-		else if(T > 1){
-			// Temperatura BAIXA: Intensificação
-			maxIteracoes = 1200;
-			alpha = 0.99;
-		}
-		else if(T > 0.1){
-			// Temperatura MUITO BAIXA: Refinamento
-			maxIteracoes = 1500;
-			alpha = 0.993;
-		}
-		else{
-			// Temperatura EXTREMAMENTE BAIXA: Busca local
-			maxIteracoes = 1200;
-			alpha = 0.995;  // Resfriamento muito lento
-		}
+		altera_parametros();
 		
 		// ====================================================================
 		// ITERAÇÕES NA TEMPERATURA ATUAL
 		// ====================================================================
 		
+		aceitos = 0;
 		for(i = 0; i < maxIteracoes; i++){
+			// Pedidos dos sinais: despejo da melhor solução e parada
+			if(atomic_load_explicit(&pedido_despejo, memory_order_relaxed) &&
+			   atomic_exchange(&pedido_despejo, 0) &&
+			   !publicaDespejo(melhor, T, relogio() - inicio_real, DESPEJO_PARCIAL))
+				atomic_store(&pedido_despejo, 1);  // Gravadora ocupada: na próxima iteração
+
+			// Melhora pendente sai quando o intervalo mínimo passou
+			if(incumbente_novo && (relogio() - ultima_gravacao >= intervalo_incumbente) &&
+			   publicaDespejo(melhor, T, relogio() - inicio_real, DESPEJO_INCUMBENTE)){
+				incumbente_novo = 0;
+				ultima_gravacao = relogio();
+			}
+			if(atomic_load_explicit(&parar_busca, memory_order_relaxed))
+				break;
+			if((prazo_sa > 0) && (relogio() - inicio_real > prazo_sa)){
+				fim_pedido = 1;
+				break;
+			}
+			traco.iteracao++;
+
 			// Copia solução atual para gerar vizinho
 			copiaMatriz(&viz, atual);
 			
-			// Recalcula FO apenas em temperatura baixa (refinamento)
-			if(T < 100)
+			// Movimento composto avaliado por delta (Kempe só sem conflitos R2)
+			if(randomInt(0, 1000) < PROB_COMPOSTO){
+				INICIO_FASE(FASE_MOVIMENTO);
+				viz.fo = atual.fo + movimentoComposto(&viz, av, r2_atual == 0);
+				FIM_FASE(FASE_MOVIMENTO);
+				r2_viz = r2_atual + av->delta[2];
+
+				// Verificação diferencial: na divergência, segue com a FO de
+				// referência e confere toda iteração daí em diante
+				if((intervalo_verificacao > 0) && (traco.iteracao % intervalo_verificacao == 0) &&
+				   !verificaDelta(atual, viz, av, traco.iteracao)){
+#ifdef VERIFICA_INVARIANTES
+					exit(1);
+#endif
+					viz.fo = calcula_FO(viz);
+					r2_viz = penalidades[2];
+					intervalo_verificacao = 1;
+				}
+			}
+			else{
+				// Recalcula FO apenas em temperatura baixa (refinamento)
+				if(T < 100){
+					INICIO_FASE(FASE_AVALIACAO);
+					viz.fo = calcula_FO(viz);
+					FIM_FASE(FASE_AVALIACAO);
+				}
+				
+				// Gera solução vizinha
+				INICIO_FASE(FASE_MOVIMENTO);
+				viz = geraViz(viz);
+				FIM_FASE(FASE_MOVIMENTO);
+				
+				// Calcula FO da vizinha
+				INICIO_FASE(FASE_AVALIACAO);
 				viz.fo = calcula_FO(viz);
+				FIM_FASE(FASE_AVALIACAO);
+				r2_viz = penalidades[2];
+			}
+
+#ifdef VERIFICA_INVARIANTES
+			if(verificaInvariantes(viz, "vizinho do SA") > 0) exit(1);
+#endif
 			
-			// Gera solução vizinha
-			viz = geraViz(viz);
-			
-			// Calcula FO da vizinha
-			viz.fo = calcula_FO(viz);
+			// Vizinho repete um estado recente: ciclo (proibido com o tabu ligado,
+			// salvo se superar a melhor solução - critério de aspiração)
+			if(estadoRecente(tabu, viz.hash)){
+				tabu->revisitas++;
+				if(param.tabu && (viz.fo >= melhor.fo)){
+					tabu->proibidos++;
+					continue;
+				}
+			}
 			
 			// Calcula diferença (delta)
-			delta = viz.fo - atual.fo;
-			delta = delta << 2;  // Multiplica por 4 (amplifica diferença)
+			variacao = (viz.fo - atual.fo) * (1LL << param.amplificacao);  // Multiplica por 4 no padrão (amplifica diferença)
+			if(variacao > 0)
+				registraDelta(&est, variacao);  // Amostra do nível de reaquecimento
 
 			// ================================================================
 			// CRITÉRIO DE ACEITAÇÃO
 			// ================================================================
 			
-			if(delta < 0){
+			if(variacao < 0){
 				// CASO 1: Vizinho é MELHOR - sempre aceita
 				copiaMatriz(&atual, viz);
+				r2_atual = r2_viz;
+				registraEstado(tabu, atual.hash);
+				aceitos++;
 				
 				// Se é o melhor global
 				if(atual.fo < melhor.fo){
 					copiaMatriz(&melhor, atual);
 					fim_forcado = 0;  // Reseta contador de estagnação
+					incumbente_novo = 1;  // Publicada no início da próxima iteração
+					registraTraco(TRACO_MELHORA, (long long)((relogio() - inicio_real) * 1000),
+					              T, melhor.fo, 0);
 					
 					// Guarda no histórico
 					aux_mat = (aux_mat + 1) % HISTORICO;
 					mat_solucao_tempo[aux_mat][0] = melhor.fo;
-					mat_solucao_tempo[aux_mat][1] = (clock() - inicio) / 1000;
+					mat_solucao_tempo[aux_mat][1] = (long long)(relogio() - inicio_real);
 					
-					// Exibe progresso
-					imprimeTempo(Tempo, hora, minuto);
-					if(viz.fo >= 1000000)
-						printf("|  Temp(K) = %.6f \t|  atual.fo = %d \t|  viz.fo = %d\t|  melhor.fo = %d\t (%d)(%d)(%d)", 
-						       T, atual.fo, viz.fo, melhor.fo, programa, rotina, fim_forcado);
-					else 
-						printf("|  Temp(K) = %.4f \t|  atual.fo = %d \t|  viz.fo = %d   \t|  melhor.fo = %d\t (%d)(%d)(%d)", 
-						       T, atual.fo, viz.fo, melhor.fo, programa, rotina, fim_forcado);
+					// Exibe progresso (formatado pela thread de log)
+					{
+						long long campos[8] = {atual.fo, viz.fo, melhor.fo, programa, rotina, fim_forcado, hora, minuto};
+						registraEvento(LOG_INFO, LOG_EVENTO_MELHORA, T, Tempo, campos, 8, NULL);
+					}
+					if(limiteAtingido(melhor.fo))
+						break;  // Atingiu o limite inferior: não há como melhorar
+					if(parar_se_viavel && (melhor.fo >= 0) && (melhor.fo < 1000000)){
+						fim_pedido = 1;
+						break;  // Primeira grade viável (teste de escala)
+					}
 				}
 			}
 			// CASO 2: Vizinho é PIOR - aceita com CRITÉRIO DE METROPOLIS
-			else if(randomDouble(0.0, 1.0) < (exp(-1 * (delta / T)))) {
+			else if(randomDouble(0.0, 1.0) < (exp(-1 * (variacao / T)))) {
 				copiaMatriz(&atual, viz);
+				r2_atual = r2_viz;
+				registraEstado(tabu, atual.hash);
+				aceitos++;
+				if(variacao > 0) est.subidas++;
 			}
 			// CASO 3: Vizinho é PIOR e não passou no critério - rejeita
 		}
@@ -1779,43 +5328,113 @@ Matriz SA(Matriz inicial){
 		// ATUALIZAÇÃO DO TEMPO
 		// ====================================================================
 		
-		fim = clock();
-		Tempo = (double)(fim - inicio) / 1000;
-		Tempo -= ((hora * 3600) + (minuto * 60));
-		if(Tempo >= 60){
-			minuto++;
-			if(minuto == 60){
-				minuto -= 60;
-				hora++;
-			}
-		}
+		decorrido = relogio() - inicio_real;
+
+		// Amostra do passo no traço de convergência
+		registraTraco(TRACO_AMOSTRA, (long long)(decorrido * 1000), T, atual.fo,
+		              (i > 0) ? (int)(1000LL * aceitos / i) : 0);
+
+		hora = (int)(decorrido / 3600);
+		minuto = (int)(decorrido / 60) % 60;
+		Tempo = decorrido - ((hora * 3600) + (minuto * 60));
 
 		// ====================================================================
 		// REAQUECIMENTO (Diversificação)
 		// ====================================================================
 		
-		if((T < Temp_reaquecimento) && (reaquecimento > 0)){
-			T = Tinicial * 0.1;  // Reaquecer para 10% da temperatura inicial
-			reaquecimento--;     // Só reaquecer uma vez
+		// Janela sem melhora e com aceitação em colapso: volta à temperatura
+		// em que a piora típica recente é aceita com chance razoável. Com
+		// prazo_sa, quantas vezes couber no prazo; sem prazo, só enquanto o
+		// reaquecimento anterior achou nova melhor solução (senão esfria até Tfinal)
+		if(fechaJanela(&est, fim_forcado) &&
+		   ((prazo_sa > 0) || (reaquecimento == 0) || (melhor.fo < est.fo_reaquecimento))){
+			est.fo_reaquecimento = melhor.fo;
+			T = temperaturaReaquecimento(&est, T, Tinicial);
+			reaquecimento++;
+			registraMensagem(LOG_INFO, "Reaquecimento %d: T = %g (passo %d, %d passos sem melhora)",
+			                 reaquecimento, T, passos, fim_forcado);
 		}
 		else {
 			T *= alpha;  // Resfriamento normal
 		}
+		
+		// Solução corrente concorre a uma vaga no conjunto elite
+		ofereceElite(elite, atual);
+
+		// Checkpoint periódico (fim de passo: estado completo e consistente)
+		passos++;
+		if((intervalo_checkpoint > 0) && (passos % intervalo_checkpoint == 0)){
+			estado = (EstadoSA){T, Tinicial, Tfinal, alpha, Tempo, maxIteracoes, hora, minuto,
+			                    reaquecimento, fim_forcado, r2_atual, passos, 0, relogio() - inicio_real, est};
+			salvaCheckpoint(&estado, &atual, &melhor, tabu);
+		}
+		FIM_FASE(FASE_PASSO_SA);
 	}
 	
 	// ========================================================================
 	// FINALIZAÇÃO
 	// ========================================================================
 	
-	printf("\nT = %.6f, Tfinal = %f, melhor.fo = %d", T, Tfinal, melhor.fo);
+	encerraDespejo();
+	esvaziaLog();  // Eventos do laço antes das mensagens finais
+	if(atomic_load(&parar_busca))
+		printf("\nBusca interrompida por sinal: salvando a melhor solução.");
+	printf("\nT = %.6f, Tfinal = %f, melhor.fo = %lld, reaquecimentos = %d", T, Tfinal, melhor.fo, reaquecimento);
+	printf("\nCiclos: %ld vizinhos repetiram um dos %d estados recentes (%ld proibidos)",
+	       tabu->revisitas, DURACAO_TABU, tabu->proibidos);
+	if(verificacoes > 0)
+		printf("\nVerificação diferencial: %ld movimentos conferidos, %ld divergências", verificacoes, divergencias);
+
+	// Religação e polimento só se ainda há o que ganhar (e não foram feitos
+	// antes do checkpoint retomado nem a busca foi interrompida por sinal ou
+	// parou na primeira grade viável); com prazo_sa, cabem no que sobrou dele
+	limite = (prazo_sa > 0) ? inicio_real + prazo_sa : 0;
+	if(!limiteAtingido(melhor.fo) && !estado.concluido && !atomic_load(&parar_busca) &&
+	   !parar_se_viavel && fase_final && ((limite == 0) || (relogio() < limite))){
+		// Religação de caminhos entre as soluções elite
+		ofereceElite(elite, melhor);
+		fo_antes = melhor.fo;
+		delta = religacaoElite(elite, &melhor, av, limite);
+		printf("\nReligação: %d caminhos melhoraram suas pontas, melhor.fo %lld -> %lld", delta, fo_antes, melhor.fo);
+
+		// Polimento: garante ótimo local para realocações e trocas
+		fo_antes = melhor.fo;
+		delta = polimento(&melhor, limite);
+		printf("\nPolimento: %d movimentos, melhor.fo %lld -> %lld", delta, fo_antes, melhor.fo);
+	}
+	printf("\nLimite inferior: %lld, gap: %lld (%.2f%%)", limite_inferior, melhor.fo - limite_inferior,
+	       melhor.fo > 0 ? 100.0 * (melhor.fo - limite_inferior) / melhor.fo : 0.0);
+
+	// Checkpoint final: a retomada de uma execução com várias grades pula
+	// as já concluídas e segue com o mesmo estado do gerador (interrompida
+	// por sinal, vale o último checkpoint periódico)
+	if((intervalo_checkpoint > 0) && !estado.concluido && !atomic_load(&parar_busca)){
+		estado = (EstadoSA){T, Tinicial, Tfinal, alpha, Tempo, maxIteracoes, hora, minuto,
+		                    reaquecimento, fim_forcado, r2_atual, passos, 1, relogio() - inicio_real, est};
+		salvaCheckpoint(&estado, &atual, &melhor, tabu);
+	}
+#ifdef VERIFICA_INVARIANTES
+	if(verificaInvariantes(melhor, "solução polida") > 0) exit(1);
+#endif
 
-	printf("\e[H\e[2J");  // Limpa terminal
+	// Melhor solução final (já polida) no arquivo da melhor solução
+	gravaGradeParcial(melhor, T, relogio() - inicio_real, arquivo_incumbente);
+
+	// Traço de convergência (com a melhora da religação e do polimento)
+	if((traco.registros > 0) && (melhor.fo < traco.ult_fo[TRACO_MELHORA]))
+		registraTraco(TRACO_MELHORA, (long long)((relogio() - inicio_real) * 1000), T, melhor.fo, 0);
+	gravaTraco();
+
+	limpaTerminal();
 	printf("\n");
-	imprimeTempo(Tempo, hora, minuto);
-	printf("\t| Temp(K) = %.4f \t| FO = %d \t| Melhor FO = %d", T, atual.fo, melhor.fo);
+	imprimeTempo(stdout, Tempo, hora, minuto);
+	printf("\t| Temp(K) = %.4f \t| FO = %lld \t| Melhor FO = %lld", T, atual.fo, melhor.fo);
 	printf("\nSimulação concluída. Digite o nome do arquivo para gravar os dados.");
 	printf("\n\t -> ");
 
+	liberaAvaliador(av);
+	liberaTabu(tabu);
+
 	return melhor;  // Retorna melhor solução encontrada
 }
 
@@ -1823,6 +5442,43 @@ Matriz SA(Matriz inicial){
 // GERAÇÃO DE SOLUÇÃO INICIAL
 // ============================================================================
 
+/*
+ * ALOCAAULAS: Aloca as últimas atribuicoes aulas da disciplina j
+ * (IDs primeira_aula[j] + disc[j].aulas - atribuicoes em diante)
+ * Prefere posição vazia, sala com capacidade e tipo, período disponível;
+ * após muitas falhas, força a alocação em qualquer posição vazia.
+ */
+void alocaAulas(Matriz *matriz, int j, int atribuicoes){
+	int i, k, cont = 0;
+
+	// Enquanto há aulas para alocar
+	while(atribuicoes > 0){
+		i = randomInt(0, total_periodos - 1);  // Período aleatório
+		k = randomInt(0, salas - 1);            // Sala aleatória
+		
+		// TENTATIVA 1: Posição vazia, capacidade OK, tipo de sala OK, sem restrição R4
+		if((matriz->n[i][k] == -1) && 
+		   (sala[k].capacidade >= disc[j].alunos) && 
+		   (restricaoR4(j, i) == 0) && (sala[k].tipo_sala>= disc[j].tipo_sala)){
+			colocaAula(matriz, i, k, primeira_aula[j] + disc[j].aulas - atribuicoes);  // Aloca
+			atribuicoes--;
+			cont -= 3;           // Reinicia contador
+		}
+		else {
+			cont++;  // Incrementa contador de falhas
+		}
+		
+		// TENTATIVA 2: Após muitas falhas, força alocação
+		if(cont > 2){
+			if(matriz->n[i][k] == -1){
+				colocaAula(matriz, i, k, primeira_aula[j] + disc[j].aulas - atribuicoes);  // Aloca forçadamente
+				atribuicoes--;
+				cont -= 3;
+			}
+		}
+	}
+}
+
 /*
  * SOLUCAOINICIAL: Gera solução inicial através de heurística construtiva
  * 
@@ -1838,47 +5494,293 @@ Matriz SA(Matriz inicial){
  * O SA vai melhorar esta solução
  */
 Matriz solucaoInicial(){
-	int i, j, k, cont, atribuicoes;
+	int j;
 	Matriz matriz = criaMatriz();
 
-	// Para cada disciplina
-	for(j = 0; j < disciplinas; j++){
-		atribuicoes = disc[j].aulas;  // Número de aulas a alocar
-		printf("disc[%d].aulas: %d\n", j, disc[j].aulas);
-		cont = 0;
-		
-		// Enquanto há aulas para alocar
-		while(atribuicoes > 0){
-			i = randomInt(0, total_periodos - 1);  // Período aleatório
-			k = randomInt(0, salas - 1);            // Sala aleatória
-			
-			// TENTATIVA 1: Posição vazia, capacidade OK, tipo de sala OK, sem restrição R4
-			if((matriz.n[i][k] == -1) && 
-			   (sala[k].capacidade >= disc[j].alunos) && 
-			   (restricaoR4(j, i) == 0) && (sala[k].tipo_sala>= disc[j].tipo_sala)){
-				matriz.n[i][k] = j;  // Aloca
-				atribuicoes--;
-				cont -= 3;           // Reinicia contador
-			}
-			else {
-				cont++;  // Incrementa contador de falhas
+	// Para cada disciplina
+	for(j = 0; j < disciplinas; j++){
+		{
+			long long campos[2] = {j, disc[j].aulas};
+			registraEvento(LOG_DEPURACAO, LOG_EVENTO_DISCIPLINA, 0, 0, campos, 2, NULL);
+		}
+		alocaAulas(&matriz, j, disc[j].aulas);
+	}
+	
+	// Calcula FO (o hash já foi mantido por colocaAula)
+	matriz.fo = calcula_FO(matriz);
+	esvaziaLog();
+	if(nivel_log >= LOG_INFO)
+		imprimeSolucao(matriz);
+	return matriz;
+}
+
+// ============================================================================
+// PARTIDA DE UMA GRADE ANTERIOR
+// ============================================================================
+
+/*
+ * Com -w, a grade parte de uma solução anterior (a do semestre passado ou a
+ * melhor de ontem) em vez de solucaoInicial, e o SA começa em TEMP_PARTIDA
+ * com prazo de PRAZO_PARTIDA segundos (se -s não deu outro): reotimizar
+ * depois de poucas mudanças não pede a execução completa.
+ * Formatos aceitos:
+ * - relatório de salvaResultado ou <saida>.melhor: a tabela após "[Dia/Per",
+ *   salas no cabeçalho e uma linha "[ dia, período" por horário;
+ * - .sol (ITC-2007): uma aula por linha, "disciplina sala dia período".
+ * Disciplinas e salas casam pelo nome. Entradas de disciplina, sala ou
+ * horário que não existem mais, em célula já ocupada ou além das aulas da
+ * disciplina são descartadas; as aulas que faltam são alocadas como em
+ * solucaoInicial.
+ */
+char *arquivo_partida = NULL;  // Grade anterior da grade em construção (NULL = solucaoInicial)
+
+/*
+ * APARANOME: Remove espaços e tabulações do início e do fim do nome
+ */
+char* aparaNome(char *nome){
+	char *fim;
+
+	while((*nome == ' ') || (*nome == '\t')) nome++;
+	fim = nome + strlen(nome);
+	while((fim > nome) && ((fim[-1] == ' ') || (fim[-1] == '\t') || (fim[-1] == '\r') || (fim[-1] == '\n')))
+		fim--;
+	*fim = '\0';
+	return nome;
+}
+
+/*
+ * COLOCAENTRADA: Coloca uma aula da grade anterior se disciplina (d), sala
+ * (s) e horário existem, a célula está vazia e a disciplina ainda tem aulas
+ * a colocar. Retorna 1 se colocou.
+ */
+int colocaEntrada(Matriz *m, int *colocadas, int d, int s, int dia, int per){
+	int p;
+
+	if((d < 0) || (s < 0) || (dia < 0) || (dia >= dias) || (per < 0) || (per >= periodos_dia))
+		return 0;
+	p = dia * periodos_dia + per;
+	if((m->n[p][s] != -1) || (colocadas[d] >= disc[d].aulas))
+		return 0;
+	colocaAula(m, p, s, primeira_aula[d] + colocadas[d]);
+	colocadas[d]++;
+	return 1;
+}
+
+/*
+ * CARREGAPARTIDA: Monta em m a grade anterior lida de arquivo
+ * Retorna 1 se aproveitou alguma aula; 0 se o arquivo não abre ou nenhuma
+ * aula casa com a instância (m fica sem alocar)
+ */
+int carregaPartida(char *arquivo, Matriz *m){
+	FILE *fp = fopen(arquivo, "r");
+	char *linha, *campo, *cabecalho = NULL;
+	char nome_disc[SIZE], nome_sala[SIZE];
+	int *coluna = NULL;     // Sala de cada coluna da tabela (-1 = não existe mais)
+	int *colocadas;         // Aulas já colocadas de cada disciplina
+	int colunas = 0, dia, per, c, d;
+	int mantidas = 0, descartadas = 0, novas = 0;
+
+	if(!fp){
+		printf("ERRO! - Não foi possível abrir a grade anterior %s\n", arquivo);
+		return 0;
+	}
+	linha = (char*) malloc(LINHA_PARTIDA);
+	colocadas = (int*) calloc(disciplinas, sizeof(int));
+	*m = criaMatriz();
+
+	// Relatório: procura o cabeçalho da tabela
+	while(fgets(linha, LINHA_PARTIDA, fp) && !(cabecalho = strstr(linha, "[Dia/Per")));
+
+	if(cabecalho != NULL){
+		coluna = (int*) malloc(strlen(cabecalho) * sizeof(int));
+		for(campo = strtok(cabecalho + 8, "|"); (campo != NULL) && (campo[0] != ']'); campo = strtok(NULL, "|"))
+			coluna[colunas++] = numSala(aparaNome(campo));
+
+		// Uma linha "[ dia, período\t|disciplina\t|...|]" por horário
+		while(fgets(linha, LINHA_PARTIDA, fp) && (sscanf(linha, "[ %d, %d", &dia, &per) == 2)){
+			campo = strchr(linha, '|');
+			if(campo == NULL) break;
+			for(c = 0, campo = strtok(campo, "|"); (campo != NULL) && (campo[0] != ']') && (c < colunas);
+			    c++, campo = strtok(NULL, "|")){
+				campo = aparaNome(campo);
+				if(strcmp(campo, "-----") == 0) continue;  // Célula vazia
+				if(colocaEntrada(m, colocadas, numDisciplina(campo), coluna[c], dia, per)) mantidas++;
+				else descartadas++;
+			}
+		}
+		free(coluna);
+	}
+	else{
+		// .sol: "disciplina sala dia período" por linha
+		rewind(fp);
+		while(fgets(linha, LINHA_PARTIDA, fp)){
+			if(sscanf(linha, "%99s %99s %d %d", nome_disc, nome_sala, &dia, &per) != 4) continue;
+			if(colocaEntrada(m, colocadas, numDisciplina(nome_disc), numSala(nome_sala), dia, per)) mantidas++;
+			else descartadas++;
+		}
+	}
+	fclose(fp);
+	free(linha);
+
+	if(mantidas == 0){
+		printf("\nAviso: nenhuma aula de %s casa com a instância; partindo da solução inicial.\n", arquivo);
+		free(colocadas);
+		liberaMatriz(*m);
+		return 0;
+	}
+
+	// Aulas novas ou descartadas: alocação da solução inicial
+	for(d = 0; d < disciplinas; d++){
+		if(colocadas[d] < disc[d].aulas){
+			novas += disc[d].aulas - colocadas[d];
+			alocaAulas(m, d, disc[d].aulas - colocadas[d]);
+		}
+	}
+	free(colocadas);
+
+	m->fo = calcula_FO(*m);
+	printf("\nPartida de %s: %d aulas mantidas, %d descartadas, %d alocadas de novo (fo = %lld)\n",
+	       arquivo, mantidas, descartadas, novas, m->fo);
+	return 1;
+}
+
+// ============================================================================
+// REINÍCIOS DO SA (LUBY / GEOMÉTRICO)
+// ============================================================================
+
+/*
+ * Com estrategia_reinicio, construcao troca o SA único por episódios curtos
+ * dentro de orcamento_reinicio segundos. O episódio k dura unidade_reinicio
+ * x luby(k) segundos (1 1 2 1 1 2 4 ...) ou unidade_reinicio x
+ * RAZAO_REINICIO^(k-1), e parte:
+ * - da melhor solução elite, a TEMP_REINICIO, se o episódio anterior
+ *   melhorou a melhor global ou partiu de uma construção nova;
+ * - de uma construção nova, a Tinicial, se o anterior partiu da elite e
+ *   não melhorou.
+ * No fim, religação e polimento da melhor global no que sobrar do
+ * orçamento. O arquivo da melhor
+ * solução só recebe a melhor global; checkpoint e traço ficam desligados
+ * nos episódios (o estado entre episódios não é gravado).
+ */
+int    estrategia_reinicio = REINICIO_NENHUM;     // REINICIO_LUBY ou REINICIO_GEOMETRICO
+double orcamento_reinicio = ORCAMENTO_REINICIO;   // Segundos da grade: episódios, religação e polimento
+double unidade_reinicio = UNIDADE_REINICIO;       // Segundos do episódio de tamanho 1
+
+/*
+ * LUBY: i-ésimo termo (i >= 1) da sequência de Luby: 1 1 2 1 1 2 4 1 1 2 ...
+ */
+int luby(int i){
+	int k = 1;
+
+	while((1 << k) - 1 < i)
+		k++;
+	if((1 << k) - 1 == i)
+		return 1 << (k - 1);
+	return luby(i - (1 << (k - 1)) + 1);
+}
+
+/*
+ * MELHORDAELITE: Índice da solução de menor FO no conjunto (-1 se vazio)
+ */
+int melhorDaElite(Elite *e){
+	int i, m = -1;
+
+	for(i = 0; i < e->quantidade; i++)
+		if((m == -1) || (e->sol[i].fo < e->sol[m].fo))
+			m = i;
+	return m;
+}
+
+/*
+ * REINICIOS: Episódios de SA com orçamento pela sequência escolhida
+ * Retorna a melhor solução encontrada (nova matriz; inicial fica intacta)
+ */
+Matriz reinicios(Matriz inicial){
+	Matriz melhor = criaMatriz();
+	Matriz partida = criaMatriz();
+	Matriz resultado;
+	Avaliador *av;
+	char incumbente[SIZE * 2], checkpoint[SIZE * 2], traco_grade[SIZE * 2];
+	double inicio = relogio(), restante, duracao, prazo_anterior = prazo_sa;
+	int fase_anterior = fase_final;
+	float temp_anterior = temperatura_partida;  // Do primeiro episódio (grade anterior, -w)
+	int k, e, da_elite = 0, melhorou = 1;
+	long long antes;
+
+	// O SA de cada episódio não grava melhor solução, checkpoint nem traço,
+	// e a religação e o polimento ficam para o fim dos episódios
+	fase_final = 0;
+	strcpy(incumbente, arquivo_incumbente);
+	strcpy(checkpoint, arquivo_checkpoint);
+	strcpy(traco_grade, arquivo_traco);
+	arquivo_incumbente[0] = arquivo_checkpoint[0] = arquivo_traco[0] = '\0';
+
+	copiaMatriz(&melhor, inicial);
+	copiaMatriz(&partida, inicial);
+	gravaGradeParcial(melhor, param.Tinicial, 0, incumbente);
+
+	for(k = 1; !atomic_load(&parar_busca) && !limiteAtingido(melhor.fo); k++){
+		restante = orcamento_reinicio - (relogio() - inicio);
+		if(restante <= 0) break;
+		duracao = unidade_reinicio * ((estrategia_reinicio == REINICIO_LUBY) ? luby(k) : pow(RAZAO_REINICIO, k - 1));
+		prazo_sa = (duracao < restante) ? duracao : restante;
+
+		// Ponto de partida: o primeiro episódio parte da solução inicial
+		if(k > 1){
+			da_elite = !da_elite || melhorou;
+			e = melhorDaElite(elite);
+			if(da_elite && (e >= 0)){
+				copiaMatriz(&partida, elite->sol[e]);
 			}
-			
-			// TENTATIVA 2: Após muitas falhas, força alocação
-			if(cont > 2){
-				if(matriz.n[i][k] == -1){
-					matriz.n[i][k] = j;  // Aloca forçadamente
-					atribuicoes--;
-					cont -= 3;
-				}
+			else{
+				da_elite = 0;
+				liberaMatriz(partida);
+				partida = solucaoInicial();
+				// Decomposição dentro do orçamento, e só se ainda cabe uma unidade
+				if(restante >= unidade_reinicio)
+					solucaoDecomposta(&partida, numThreads(), inicio + orcamento_reinicio);
 			}
 		}
+		temperatura_partida = da_elite ? TEMP_REINICIO : ((k == 1) ? temp_anterior : 0);
+
+		antes = melhor.fo;
+		resultado = SA(partida);
+		melhorou = (resultado.fo < melhor.fo);
+		if(melhorou){
+			copiaMatriz(&melhor, resultado);
+			gravaGradeParcial(melhor, T, relogio() - inicio, incumbente);
+		}
+		ofereceElite(elite, resultado);
+		printf("\nEpisódio %d (%s, %.1fs): fo %lld, melhor.fo %lld -> %lld\n", k,
+		       da_elite ? "elite" : (k > 1 ? "construção nova" : "solução inicial"), prazo_sa,
+		       resultado.fo, antes, melhor.fo);
+		liberaMatriz(resultado);
 	}
-	
-	// Calcula FO da solução inicial
-	matriz.fo = calcula_FO(matriz);
-	imprimeSolucao(matriz);
-	return matriz;
+	prazo_sa = prazo_anterior;
+	temperatura_partida = temp_anterior;
+	fase_final = fase_anterior;
+
+	// Religação entre as soluções elite dos episódios e polimento final,
+	// no restante do orçamento
+	if(!atomic_load(&parar_busca) && !limiteAtingido(melhor.fo) &&
+	   (relogio() < inicio + orcamento_reinicio)){
+		av = criaAvaliador();
+		ofereceElite(elite, melhor);
+		antes = melhor.fo;
+		e = religacaoElite(elite, &melhor, av, inicio + orcamento_reinicio);
+		printf("\nReligação: %d caminhos melhoraram suas pontas, melhor.fo %lld -> %lld", e, antes, melhor.fo);
+		antes = melhor.fo;
+		e = polimento(&melhor, inicio + orcamento_reinicio);
+		printf("\nPolimento: %d movimentos, melhor.fo %lld -> %lld\n", e, antes, melhor.fo);
+		liberaAvaliador(av);
+	}
+
+	strcpy(arquivo_incumbente, incumbente);
+	strcpy(arquivo_checkpoint, checkpoint);
+	strcpy(arquivo_traco, traco_grade);
+	gravaGradeParcial(melhor, T, relogio() - inicio, arquivo_incumbente);
+	liberaMatriz(partida);
+	return melhor;
 }
 
 // ============================================================================
@@ -1908,7 +5810,7 @@ void salvaResultado(Matriz matriz, char *str){
 		return;
 	}
 	
-	int i, j, k, p, a;
+	int i, j, p, a;
 
 	// ========================================================================
 	// PRIMEIRA EXECUÇÃO: Salva dados da instância
@@ -1926,7 +5828,9 @@ void salvaResultado(Matriz matriz, char *str){
 		sprintf(res, "%sRestricoes: %d\n", res, restricoes);
 		
 		// Valor da Função Objetivo
-		sprintf(res, "%sFunção Objetivo (FO): %d\n", res, matriz.fo);
+		sprintf(res, "%sFunção Objetivo (FO): %lld\n", res, matriz.fo);
+		a = strlen(res);
+		snprintf(res + a, SAIDA - a, "Limite inferior: %lld (gap: %lld)\n", limite_inferior, matriz.fo - limite_inferior);
 		
 		// Relatório de violações
 		sprintf(res, "%s\n============ RELATÓRIO DE VIOLAÇÕES ============\n", res);
@@ -2019,6 +5923,10 @@ void salvaResultado(Matriz matriz, char *str){
 		}
 	}
 
+#ifdef CONTADORES_HW
+	relatorioContadores(fp);
+#endif
+
 	// ========================================================================
 	// HISTÓRICO DE BUSCA
 	// ========================================================================
@@ -2030,14 +5938,11 @@ void salvaResultado(Matriz matriz, char *str){
 	
 	for(i = 0; i < HISTORICO; i++){
 		if(i == 0){
-			sprintf(res, "\n\n\n%dº Execução: ***FO = %d***\n", rotina+1, matriz.fo);
+			sprintf(res, "\n\n\n%dº Execução: ***FO = %lld***\n", rotina+1, matriz.fo);
 			for(a = 0; res[a]; a++) 
 				putc(res[a], fp);
 		}
-		j = mat_solucao_tempo[aux_mat][0];  // FO
-		k = mat_solucao_tempo[aux_mat][1];  // Tempo
-
-		sprintf(res, "\n%dº: %d  %d", i+1, k, j);
+		sprintf(res, "\n%dº: %lld  %lld", i+1, mat_solucao_tempo[aux_mat][1], mat_solucao_tempo[aux_mat][0]);  // Tempo e FO
 		for(a = 0; res[a]; a++) 
 			putc(res[a], fp);
 		
@@ -2049,6 +5954,863 @@ void salvaResultado(Matriz matriz, char *str){
 	fclose(fp);
 }
 
+// ============================================================================
+// GERADOR DE INSTÂNCIAS E TESTE DE ESCALA
+// ============================================================================
+
+/*
+ * Instâncias sintéticas no formato lido por leArquivos, para medir o solver
+ * em tamanhos maiores que os das instâncias reais. Campos com 0 são
+ * derivados do número de disciplinas.
+ */
+typedef struct parametrosGerador{
+	int disciplinas;             // Disciplinas (courses)
+	int salas;                   // Salas (0 = ocupação de ~70% dos horários)
+	int tipos;                   // Tipos de sala
+	int cursos;                  // Currículos (0 = disciplinas / 5)
+	int densidade;               // Disciplinas por currículo (média)
+	int professores;             // Professores (0 = disciplinas / 2)
+	double indisponibilidade;    // Fração dos períodos indisponíveis por disciplina
+	int dias;                    // Dias da semana
+	int periodos_dia;            // Períodos por dia
+	unsigned long long semente;  // Estado inicial do gerador aleatório
+}ParametrosGerador;
+
+/*
+ * PARAMETROSPADRAO: 100 disciplinas, 3 tipos de sala, 5 dias x 6 períodos
+ */
+ParametrosGerador parametrosPadrao(){
+	return (ParametrosGerador){100, 0, 3, 0, 5, 0, 0.05, 5, 6, 1};
+}
+
+/*
+ * LEPARAMETROGERADOR: Lê um parâmetro "chave=valor" do gerador
+ * Retorna 1 se a chave existe, 0 caso contrário
+ */
+int leParametroGerador(ParametrosGerador *p, char *texto){
+	char *valor = strchr(texto, '=');
+	size_t n;
+
+	if(valor == NULL) return 0;
+	n = valor - texto;
+	valor++;
+
+	if(strncmp(texto, "disciplinas", n) == 0) p->disciplinas = atoi(valor);
+	else if(strncmp(texto, "salas", n) == 0) p->salas = atoi(valor);
+	else if(strncmp(texto, "tipos", n) == 0) p->tipos = atoi(valor);
+	else if(strncmp(texto, "cursos", n) == 0) p->cursos = atoi(valor);
+	else if(strncmp(texto, "densidade", n) == 0) p->densidade = atoi(valor);
+	else if(strncmp(texto, "professores", n) == 0) p->professores = atoi(valor);
+	else if(strncmp(texto, "indisponibilidade", n) == 0) p->indisponibilidade = atof(valor);
+	else if(strncmp(texto, "dias", n) == 0) p->dias = atoi(valor);
+	else if(strncmp(texto, "periodos", n) == 0) p->periodos_dia = atoi(valor);
+	else if(strncmp(texto, "semente", n) == 0) p->semente = strtoull(valor, NULL, 10);
+	else return 0;
+	return 1;
+}
+
+/*
+ * GERAINSTANCIA: Grava uma instância sintética no formato de leArquivos
+ * 
+ * - Aulas por disciplina entre 1 e min(5, dias), dias mínimos até as aulas
+ *   (R11 e R5 sempre atendíveis)
+ * - 70% das disciplinas pedem salas do tipo 1, as demais um tipo sorteado
+ * - R10 exige o tipo exato: cada tipo recebe salas cujos horários cobrem
+ *   suas aulas, e a primeira sala de cada tipo tem a maior capacidade
+ * - Salas automáticas ocupam ~70% dos horários, nunca menos que o mínimo
+ *   dos tipos; as que passam do mínimo vão ao tipo mais ocupado
+ * - Currículos com densidade ± 2 disciplinas distintas
+ * - Indisponibilidades sorteadas período a período, agrupadas por disciplina
+ * 
+ * Completa em p os campos derivados. Retorna 1 se gravou, 0 se não conseguiu
+ * criar o arquivo.
+ */
+int geraInstancia(ParametrosGerador *p, char *arquivo){
+	FILE *fp;
+	int i, j, k, q, t, n, max_aulas, total_aulas = 0, restr = 0;
+	int per = p->dias * p->periodos_dia;
+	int *aulas, *marca, *tipo, *aulas_tipo, *salas_tipo;
+	char *indisp;
+
+	fp = fopen(arquivo, "w");
+	if(!fp) return 0;
+
+	// Campos derivados
+	if(p->tipos < 1) p->tipos = 1;
+	if(p->cursos <= 0) p->cursos = (p->disciplinas / 5 > 0) ? p->disciplinas / 5 : 1;
+	if(p->professores <= 0) p->professores = (p->disciplinas / 2 > 0) ? p->disciplinas / 2 : 1;
+	if(p->densidade > p->disciplinas) p->densidade = p->disciplinas;
+	if(p->densidade < 1) p->densidade = 1;
+	estado_rng = (p->semente != 0) ? p->semente : 1;  // O xorshift não sai do zero
+	max_aulas = (p->dias < 5) ? p->dias : 5;
+
+	aulas = (int*) malloc(p->disciplinas * sizeof(int));
+	marca = (int*) calloc(p->disciplinas, sizeof(int));
+	tipo = (int*) malloc(p->disciplinas * sizeof(int));
+	aulas_tipo = (int*) calloc(p->tipos + 1, sizeof(int));
+	salas_tipo = (int*) calloc(p->tipos + 1, sizeof(int));
+	indisp = (char*) calloc((size_t)p->disciplinas * per, sizeof(char));
+
+	for(i = 0; i < p->disciplinas; i++){
+		aulas[i] = randomInt(1, max_aulas);
+		tipo[i] = (randomInt(0, 9) < 7) ? 1 : randomInt(1, p->tipos);
+		aulas_tipo[tipo[i]] += aulas[i];
+		total_aulas += aulas[i];
+	}
+
+	// Salas de cada tipo: horários para todas as aulas do tipo (R10)
+	n = 0;
+	for(t = 1; t <= p->tipos; t++){
+		salas_tipo[t] = (aulas_tipo[t] + per - 1) / per;
+		n += salas_tipo[t];
+	}
+	if(p->salas <= 0) p->salas = (int)ceil(total_aulas / (0.7 * per));
+	if(p->salas < n) p->salas = n;
+
+	// Salas além do mínimo, uma a uma, para o tipo de maior ocupação
+	for(k = n; k < p->salas; k++){
+		q = 1;
+		for(t = 2; t <= p->tipos; t++)
+			if((double)aulas_tipo[t] * salas_tipo[q] > (double)aulas_tipo[q] * salas_tipo[t])
+				q = t;
+		salas_tipo[q]++;
+	}
+
+	for(i = 0; i < p->disciplinas; i++)
+		for(j = 0; j < per; j++)
+			if(randomDouble(0.0, 1.0) < p->indisponibilidade){
+				indisp[(size_t)i * per + j] = 1;
+				restr++;
+			}
+
+	// Cabeçalho
+	fprintf(fp, "Name: Sintetica_%d\n", p->disciplinas);
+	fprintf(fp, "Courses: %d\nRooms: %d\nDays: %d\nPeriods_per_day: %d\n",
+	        p->disciplinas, p->salas, p->dias, p->periodos_dia);
+	fprintf(fp, "Curricula: %d\nConstraints: %d\n\n", p->cursos, restr);
+
+	// Disciplinas: nome professor aulas dias_mínimos alunos tipo_sala
+	fprintf(fp, "COURSES:\n");
+	for(i = 0; i < p->disciplinas; i++)
+		fprintf(fp, "c%05d t%05d %d %d %d %d\n", i, randomInt(0, p->professores - 1), aulas[i],
+		        randomInt(1, aulas[i]), randomInt(1, 24) * 10, tipo[i]);
+
+	// Salas: nome capacidade tipo (a primeira de cada tipo recebe qualquer turma)
+	fprintf(fp, "\nROOMS:\n");
+	k = 0;
+	for(t = 1; t <= p->tipos; t++)
+		for(j = 0; j < salas_tipo[t]; j++, k++)
+			fprintf(fp, "r%04d %d %d\n", k, (j == 0) ? 250 : randomInt(2, 25) * 10, t);
+
+	// Currículos: nome quantidade disciplinas...
+	fprintf(fp, "\nCURRICULA:\n");
+	for(q = 0; q < p->cursos; q++){
+		n = p->densidade + randomInt(-2, 2);
+		if(n < 1) n = 1;
+		if(n > p->disciplinas) n = p->disciplinas;
+		fprintf(fp, "q%04d %d ", q, n);
+		for(j = 0; j < n; j++){
+			do i = randomInt(0, p->disciplinas - 1); while(marca[i] == q + 1);
+			marca[i] = q + 1;
+			fprintf(fp, " c%05d", i);
+		}
+		fprintf(fp, "\n");
+	}
+
+	// Indisponibilidades: disciplina dia período
+	fprintf(fp, "\nUNAVAILABILITY_CONSTRAINTS:\n");
+	for(i = 0; i < p->disciplinas; i++)
+		for(j = 0; j < per; j++)
+			if(indisp[(size_t)i * per + j])
+				fprintf(fp, "c%05d %d %d\n", i, j / p->periodos_dia, j % p->periodos_dia);
+	fprintf(fp, "\nEND.\n");
+
+	fclose(fp);
+	free(aulas);
+	free(marca);
+	free(tipo);
+	free(aulas_tipo);
+	free(salas_tipo);
+	free(indisp);
+	return 1;
+}
+
+/*
+ * PREPARAINSTANCIA: Lê a instância e prepara as estruturas da busca
+ * (mesma sequência de construcao, sem a saída e a solução inicial)
+ * 
+ * Guarda em leitura (se não for NULL) os segundos de leArquivos.
+ * Retorna 1 se leu, 0 se o arquivo não existe ou não pôde ser lido.
+ */
+int preparaInstancia(char *arquivo, double *leitura){
+	FILE *fp = fopen(arquivo, "r");
+	double t0;
+
+	if(!fp) return 0;  // leArquivos esperaria o usuário
+	fclose(fp);
+
+	if(elite != NULL){
+		liberaElite(elite);
+		elite = NULL;
+	}
+	t0 = relogio();
+	if(!leArquivos(arquivo)) return 0;
+	if(leitura != NULL) *leitura = relogio() - t0;
+	rotina = 1;  // A próxima leitura libera as estruturas desta
+	iniciaZobrist();
+	elite = criaElite(TAM_ELITE);
+	decompoeInstancia();
+	verificaViabilidade();
+	limiteInferior();
+	return 1;
+}
+
+/*
+ * TESTEESCALA: Mede o solver em instâncias sintéticas de tamanho crescente
+ * 
+ * Para cada tamanho (número de disciplinas) grava <prefixo>_<tamanho>, lê
+ * e mede:
+ * - leitura: tempo de leArquivos
+ * - FO: custo médio de uma chamada de calcula_FO
+ * - delta: custo médio de um movimento composto avaliado por delta
+ * - viável: tempo do SA, a partir da solução inicial, até a primeira grade
+ *   sem violações graves (limitado a prazo segundos; -1 = não chegou)
+ * 
+ * O CSV traz também maiorFO, até onde a FO da instância poderia chegar.
+ * Os resultados saem em tabela e em <prefixo>.csv.
+ */
+void testeEscala(ParametrosGerador base, int *tamanhos, int n, double prazo, char *prefixo){
+	char arquivo[SIZE * 2 + 16];
+	FILE *csv;
+	Matriz m, copia, melhor;
+	Avaliador *av;
+	ParametrosGerador p;
+	double t0, leitura, fo_us, delta_us, viavel;
+	long chamadas;
+	long long maior;
+	int k, i, aulas;
+	char linhas[MAX_TAMANHOS][SIZE * 2];  // Linhas da tabela (repetida no fim)
+	const char *titulo = "Discipl.  Salas  Curr.  Profs   Aulas  Leitura(ms)     FO(us)  Delta(us)  Viável(s)     FO final";
+
+	sprintf(arquivo, "%s.csv", prefixo);
+	csv = fopen(arquivo, "w");
+	if(!csv){
+		printf("ERRO! - Não foi possível criar %s\n", arquivo);
+		return;
+	}
+	fprintf(csv, "disciplinas,salas,cursos,professores,aulas,leitura_ms,fo_us,delta_us,viavel_s,fo_final,maior_fo\n");
+
+	// Sem arquivos auxiliares por grade; o SA para na primeira grade viável
+	arquivo_checkpoint[0] = arquivo_despejo[0] = arquivo_incumbente[0] = arquivo_traco[0] = '\0';
+	prazo_sa = prazo;
+	parar_se_viavel = 1;
+	if(nivel_log == LOG_INFO)
+		nivel_log = LOG_AVISO;  // Sem a grade inicial e as melhoras de cada tamanho
+
+	if(n > MAX_TAMANHOS) n = MAX_TAMANHOS;
+	for(k = 0; (k < n) && !atomic_load(&parar_busca); k++){
+		p = base;
+		p.disciplinas = tamanhos[k];
+		sprintf(arquivo, "%s_%d", prefixo, tamanhos[k]);
+		if(!geraInstancia(&p, arquivo)){
+			printf("ERRO! - Não foi possível criar %s\n", arquivo);
+			break;
+		}
+
+		if(!preparaInstancia(arquivo, &leitura)) break;
+		for(i = 0, aulas = 0; i < disciplinas; i++)
+			aulas += disc[i].aulas;
+		maior = maiorFO();
+
+		m = solucaoInicial();
+
+		// Custo da FO completa
+		chamadas = 0;
+		t0 = relogio();
+		do{
+			calcula_FO(m);
+			chamadas++;
+		}while(relogio() - t0 < JANELA_MEDICAO);
+		fo_us = 1e6 * (relogio() - t0) / chamadas;
+
+		// Custo de um movimento composto com delta (em uma cópia da solução)
+		copia = criaMatriz();
+		copiaMatriz(&copia, m);
+		av = criaAvaliador();
+		chamadas = 0;
+		t0 = relogio();
+		do{
+			movimentoComposto(&copia, av, 0);
+			chamadas++;
+		}while(relogio() - t0 < JANELA_MEDICAO);
+		delta_us = 1e6 * (relogio() - t0) / chamadas;
+		liberaAvaliador(av);
+		liberaMatriz(copia);
+
+		// Tempo até a primeira grade sem violações graves
+		t0 = relogio();
+		melhor = SA(m);
+		viavel = (melhor.fo < 1000000) ? relogio() - t0 : -1;
+
+		sprintf(linhas[k], "%8d %6d %6d %6d %7d %12.1f %10.2f %10.2f %10.2f %12lld", disciplinas, salas,
+		        cursos, professores, aulas, leitura * 1000, fo_us, delta_us, viavel, melhor.fo);
+		printf("\n\n%s\n%s\n", titulo, linhas[k]);
+		fprintf(csv, "%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%lld,%lld\n", disciplinas, salas, cursos, professores,
+		        aulas, leitura * 1000, fo_us, delta_us, viavel, melhor.fo, maior);
+		fflush(csv);
+
+		liberaMatriz(m);
+		liberaMatriz(melhor);
+	}
+
+	prazo_sa = 0;
+	parar_se_viavel = 0;
+	fclose(csv);
+
+	printf("\n\n============ TESTE DE ESCALA ============\n%s\n", titulo);
+	for(i = 0; i < k; i++)
+		printf("%s\n", linhas[i]);
+	printf("\nResultados em %s.csv\n", prefixo);
+}
+
+// ============================================================================
+// ARQUIVO DE PARÂMETROS E CORRIDA DE CONFIGURAÇÕES (RACING)
+// ============================================================================
+
+/*
+ * Formato do arquivo de parâmetros (uma chave por linha, '#' comenta):
+ *   Tinicial 1000000
+ *   Tfinal 1e-05
+ *   limiares 1000 100 10 1 0.1             (NUM_FAIXAS_T - 1, decrescentes)
+ *   iteracoes 600 800 1000 1200 1500 1200  (NUM_FAIXAS_T)
+ *   alpha 0.98 0.97 0.98 0.99 0.993 0.995  (NUM_FAIXAS_T)
+ *   amplificacao 2
+ *   estagnacao 8000
+ *   faixas 100 200 300 400 500 600 700 800 900  (NUM_FAIXAS_VIZ, crescentes)
+ *   janela 50
+ *   aceitacao_minima 0.002
+ *   aceitacao_reaquecimento 0.3
+ *   tabu 0                                  (1 = proíbe os estados aceitos recentes)
+ * Chaves ausentes ficam com o valor atual.
+ */
+
+/*
+ * LEVALORES: Lê n números da linha; retorna quantos leu
+ */
+int leValores(char *texto, double *valores, int n){
+	char *fim;
+	int lidos = 0;
+
+	while(lidos < n){
+		valores[lidos] = strtod(texto, &fim);
+		if(fim == texto) break;
+		texto = fim;
+		lidos++;
+	}
+	return lidos;
+}
+
+/*
+ * PARAMETROSVALIDOS: Confere os limites de uma configuração
+ */
+int parametrosValidos(ParametrosSA *p){
+	int i;
+
+	if((p->Tfinal <= 0) || (p->Tinicial <= p->Tfinal)) return 0;
+	if((p->amplificacao < 0) || (p->amplificacao > 8) || (p->estagnacao < 1)) return 0;
+	if((p->janela < 1) || (p->aceitacao_minima < 0) || (p->aceitacao_minima >= 1) ||
+	   (p->aceitacao_reaquecimento <= 0) || (p->aceitacao_reaquecimento >= 1)) return 0;
+	if((p->tabu != 0) && (p->tabu != 1)) return 0;
+	for(i = 0; i < NUM_FAIXAS_T; i++)
+		if((p->iteracoes[i] < 1) || (p->alpha[i] <= 0) || (p->alpha[i] >= 1)) return 0;
+	for(i = 1; i < NUM_FAIXAS_T - 1; i++)
+		if(p->limiar[i] >= p->limiar[i - 1]) return 0;
+	for(i = 0; i < NUM_FAIXAS_VIZ; i++)
+		if((p->faixa_viz[i] < 0) || (p->faixa_viz[i] > 1000) || ((i > 0) && (p->faixa_viz[i] < p->faixa_viz[i - 1])))
+			return 0;
+	return 1;
+}
+
+/*
+ * LELINHAPARAMETRO: Aplica em p a chave e os valores de uma linha
+ * Retorna 1 se a chave existe e tem o número certo de valores
+ */
+int leLinhaParametro(char *chave, char *valores, ParametrosSA *p){
+	double v[NUM_FAIXAS_VIZ];
+	int i, n = leValores(valores, v, NUM_FAIXAS_VIZ);
+
+	if((strcmp(chave, "Tinicial") == 0) && (n == 1)) p->Tinicial = v[0];
+	else if((strcmp(chave, "Tfinal") == 0) && (n == 1)) p->Tfinal = v[0];
+	else if((strcmp(chave, "limiares") == 0) && (n == NUM_FAIXAS_T - 1))
+		for(i = 0; i < n; i++) p->limiar[i] = v[i];
+	else if((strcmp(chave, "iteracoes") == 0) && (n == NUM_FAIXAS_T))
+		for(i = 0; i < n; i++) p->iteracoes[i] = (int)v[i];
+	else if((strcmp(chave, "alpha") == 0) && (n == NUM_FAIXAS_T))
+		for(i = 0; i < n; i++) p->alpha[i] = v[i];
+	else if((strcmp(chave, "amplificacao") == 0) && (n == 1)) p->amplificacao = (int)v[0];
+	else if((strcmp(chave, "estagnacao") == 0) && (n == 1)) p->estagnacao = (int)v[0];
+	else if((strcmp(chave, "faixas") == 0) && (n == NUM_FAIXAS_VIZ))
+		for(i = 0; i < n; i++) p->faixa_viz[i] = (int)v[i];
+	else if((strcmp(chave, "janela") == 0) && (n == 1)) p->janela = (int)v[0];
+	else if((strcmp(chave, "aceitacao_minima") == 0) && (n == 1)) p->aceitacao_minima = v[0];
+	else if((strcmp(chave, "aceitacao_reaquecimento") == 0) && (n == 1)) p->aceitacao_reaquecimento = v[0];
+	else if((strcmp(chave, "tabu") == 0) && (n == 1)) p->tabu = (int)v[0];
+	else return 0;
+	return 1;
+}
+
+/*
+ * LEPARAMETROS: Lê o arquivo de parâmetros sobre a configuração p
+ * Retorna 1 se leu uma configuração válida, 0 caso contrário (p intacta)
+ */
+int leParametros(char *arquivo, ParametrosSA *p){
+	FILE *fp = fopen(arquivo, "r");
+	ParametrosSA lido = *p;
+	char linha[SIZE * 4], chave[SIZE];
+	int desloc, ok = 1;
+
+	if(!fp){
+		printf("ERRO! - Não foi possível abrir os parâmetros %s\n", arquivo);
+		return 0;
+	}
+	while(ok && fgets(linha, sizeof(linha), fp)){
+		if((sscanf(linha, "%99s%n", chave, &desloc) != 1) || (chave[0] == '#')) continue;
+		if(!leLinhaParametro(chave, linha + desloc, &lido)){
+			printf("ERRO! - %s: chave desconhecida ou valores faltando: %s", arquivo, linha);
+			ok = 0;
+		}
+	}
+	fclose(fp);
+
+	if(ok && !parametrosValidos(&lido)){
+		printf("ERRO! - %s: parâmetros fora dos limites\n", arquivo);
+		ok = 0;
+	}
+	if(ok) *p = lido;
+	return ok;
+}
+
+/*
+ * GRAVAPARAMETROS: Escreve a configuração no formato de leParametros
+ */
+void gravaParametros(FILE *fp, ParametrosSA *p){
+	int i;
+
+	fprintf(fp, "Tinicial %.7g\nTfinal %.7g\nlimiares", p->Tinicial, p->Tfinal);
+	for(i = 0; i < NUM_FAIXAS_T - 1; i++) fprintf(fp, " %.7g", p->limiar[i]);
+	fprintf(fp, "\niteracoes");
+	for(i = 0; i < NUM_FAIXAS_T; i++) fprintf(fp, " %d", p->iteracoes[i]);
+	fprintf(fp, "\nalpha");
+	for(i = 0; i < NUM_FAIXAS_T; i++) fprintf(fp, " %.7g", p->alpha[i]);
+	fprintf(fp, "\namplificacao %d\nestagnacao %d\nfaixas", p->amplificacao, p->estagnacao);
+	for(i = 0; i < NUM_FAIXAS_VIZ; i++) fprintf(fp, " %d", p->faixa_viz[i]);
+	fprintf(fp, "\njanela %d\naceitacao_minima %.7g\naceitacao_reaquecimento %.7g\ntabu %d\n",
+	        p->janela, p->aceitacao_minima, p->aceitacao_reaquecimento, p->tabu);
+}
+
+/*
+ * SORTEIAPARAMETROS: Configuração aleatória em torno da base
+ * Temperaturas em escala logarítmica, iterações e (1 - alpha) entre metade
+ * e o dobro, limites das faixas do geraViz deslocados até ±50, janela de
+ * estagnação e taxas de aceitação entre metade e o dobro; tabu ligado ou não.
+ */
+void sorteiaParametros(ParametrosSA *p, ParametrosSA *base){
+	int i;
+
+	do{
+		*p = *base;
+		p->Tinicial = pow(10, randomDouble(3, 7));
+		p->Tfinal = pow(10, randomDouble(-6, -2));
+		for(i = 0; i < NUM_FAIXAS_T - 1; i++)
+			p->limiar[i] = base->limiar[i] * pow(10, randomDouble(-0.5, 0.5));
+		for(i = 0; i < NUM_FAIXAS_T; i++){
+			p->iteracoes[i] = (int)(base->iteracoes[i] * pow(2, randomDouble(-1, 1)));
+			p->alpha[i] = 1 - (1 - base->alpha[i]) * pow(2, randomDouble(-1, 1));
+			if(p->alpha[i] > 0.9995) p->alpha[i] = 0.9995;
+		}
+		p->amplificacao = randomInt(0, 4);
+		p->estagnacao = randomInt(1000, 16000);
+		for(i = 0; i < NUM_FAIXAS_VIZ; i++){
+			p->faixa_viz[i] = base->faixa_viz[i] + randomInt(-50, 50);
+			if(p->faixa_viz[i] < 0) p->faixa_viz[i] = 0;
+			if(p->faixa_viz[i] > 1000) p->faixa_viz[i] = 1000;
+			if((i > 0) && (p->faixa_viz[i] < p->faixa_viz[i - 1])) p->faixa_viz[i] = p->faixa_viz[i - 1];
+		}
+		p->janela = (int)(base->janela * pow(2, randomDouble(-1, 1)));
+		p->aceitacao_minima = base->aceitacao_minima * pow(2, randomDouble(-1, 1));
+		p->aceitacao_reaquecimento = base->aceitacao_reaquecimento * pow(2, randomDouble(-1, 1));
+		p->tabu = randomInt(0, 1);
+	}while(!parametrosValidos(p));
+}
+
+/*
+ * QUANTILNORMAL: Quantil da normal padrão (aproximação de Abramowitz-Stegun
+ * 26.2.23, erro < 4.5e-4), para 0.5 <= q < 1
+ */
+double quantilNormal(double q){
+	double t = sqrt(-2 * log(1 - q));
+	return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+	           (1 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+/*
+ * QUANTILT: Quantil da t de Student com gl graus de liberdade
+ * (expansão de Cornish-Fisher em torno da normal)
+ */
+double quantilT(double q, double gl){
+	double z = quantilNormal(q), z3 = z * z * z, z5 = z3 * z * z;
+	return z + (z3 + z) / (4 * gl) + (5 * z5 + 16 * z3 + 3 * z) / (96 * gl * gl);
+}
+
+/*
+ * QUANTILQUIQUADRADO: Quantil da qui-quadrado com gl graus de liberdade
+ * (aproximação de Wilson-Hilferty)
+ */
+double quantilQuiQuadrado(double q, double gl){
+	double a = 2 / (9 * gl);
+	return gl * pow(1 - a + quantilNormal(q) * sqrt(a), 3);
+}
+
+/*
+ * EXECUTACONFIGURACOES: Roda o SA de cada configuração viva na instância
+ * carregada, em processos filhos (até numThreads() ao mesmo tempo)
+ *
+ * Todos partem da mesma semente (números aleatórios comuns) e têm prazo
+ * segundos de SA. O filho devolve melhor.fo por um pipe; filho que falha
+ * vale LLONG_MAX.
+ *
+ * O filho não herda a thread de sinais: volta à máscara padrão (SIGINT e
+ * SIGTERM o encerram) e, com a parada pedida, o pai encerra o lote.
+ */
+void executaConfiguracoes(ParametrosSA *conf, int *vivo, int n, unsigned long long semente,
+                          double prazo, long long *resultado){
+	int paralelo = numThreads(), fd[MAX_THREADS], alvo[MAX_THREADS];
+	pid_t pid[MAX_THREADS];
+	int c = 0, lote, j, k, canal[2];
+	long long fo;
+	struct pollfd aviso;
+	sigset_t padrao;
+	Matriz m, melhor;
+
+	while((c < n) && !atomic_load(&parar_busca)){
+		// Dispara um lote de filhos
+		fflush(stdout);  // Nada pendente para os filhos repetirem
+		for(lote = 0; (c < n) && (lote < paralelo); c++){
+			if(!vivo[c]) continue;
+			resultado[c] = LLONG_MAX;
+			if(pipe(canal) != 0) continue;
+			pid[lote] = fork();
+			if(pid[lote] == 0){
+				sigemptyset(&padrao);
+				pthread_sigmask(SIG_SETMASK, &padrao, NULL);
+				close(canal[0]);
+				if(freopen("/dev/null", "w", stdout) == NULL) _exit(1);
+				log_ativo = 0;  // A thread de log ficou no pai
+				nivel_log = LOG_ERRO;
+				param = conf[c];
+				estado_rng = semente;
+				prazo_sa = prazo;
+				fase_final = 0;  // Compara só o SA: religação e polimento dominariam a FO
+				m = solucaoInicial();
+				melhor = SA(m);
+				fo = (melhor.fo < 0) ? LLONG_MAX : melhor.fo;
+				if(write(canal[1], &fo, sizeof(long long)) != sizeof(long long)) _exit(1);
+				_exit(0);
+			}
+			close(canal[1]);
+			if(pid[lote] < 0){
+				close(canal[0]);
+				continue;
+			}
+			fd[lote] = canal[0];
+			alvo[lote] = c;
+			lote++;
+		}
+
+		// Recolhe os resultados do lote (parada pedida: encerra os que faltam)
+		for(j = 0; j < lote; j++){
+			aviso.fd = fd[j];
+			aviso.events = POLLIN;
+			while(poll(&aviso, 1, 200) == 0)
+				if(atomic_load(&parar_busca))
+					for(k = j; k < lote; k++) kill(pid[k], SIGTERM);
+			if(read(fd[j], &fo, sizeof(long long)) == sizeof(long long))
+				resultado[alvo[j]] = fo;
+			close(fd[j]);
+			waitpid(pid[j], NULL, 0);
+		}
+	}
+}
+
+/*
+ * POSTOSFRIEDMAN: Postos (1 = melhor, empates com a média) das
+ * configurações vivas em cada instância concluída; soma em soma_posto
+ */
+void postosFriedman(long long *fo, int etapas, int n, int *vivo, double *posto, double *soma_posto){
+	int s, c, d, menores, iguais;
+
+	for(c = 0; c < n; c++) soma_posto[c] = 0;
+	for(s = 0; s < etapas; s++)
+		for(c = 0; c < n; c++){
+			if(!vivo[c]) continue;
+			menores = iguais = 0;
+			for(d = 0; d < n; d++){
+				if(!vivo[d]) continue;
+				if(fo[s * n + d] < fo[s * n + c]) menores++;
+				else if(fo[s * n + d] == fo[s * n + c]) iguais++;
+			}
+			posto[s * n + c] = menores + (iguais + 1) / 2.0;
+			soma_posto[c] += posto[s * n + c];
+		}
+}
+
+/*
+ * ELIMINAFRIEDMAN: Teste de Friedman entre as configurações vivas e, se
+ * rejeitar a igualdade, elimina as piores pelo teste de Conover contra a
+ * melhor (como no irace). Retorna quantas eliminou.
+ */
+int eliminaFriedman(long long *fo, int etapas, int n, int *vivo, double *posto, double *soma_posto){
+	double A = 0, C, Tf = 0, limite, b = etapas, k = 0;
+	int s, c, melhor = -1, eliminadas = 0;
+
+	postosFriedman(fo, etapas, n, vivo, posto, soma_posto);
+	for(c = 0; c < n; c++){
+		if(!vivo[c]) continue;
+		k++;
+		if((melhor == -1) || (soma_posto[c] < soma_posto[melhor])) melhor = c;
+		for(s = 0; s < etapas; s++) A += posto[s * n + c] * posto[s * n + c];
+	}
+	if((k < 2) || (b < 2)) return 0;
+
+	C = b * k * (k + 1) * (k + 1) / 4;
+	if(A - C < 1e-9) return 0;  // Todas empatadas em todas as instâncias
+	for(c = 0; c < n; c++)
+		if(vivo[c]) Tf += (soma_posto[c] - b * (k + 1) / 2) * (soma_posto[c] - b * (k + 1) / 2);
+	Tf *= (k - 1) / (A - C);
+	if(Tf <= quantilQuiQuadrado(0.95, k - 1)) return 0;
+
+	limite = quantilT(0.975, (b - 1) * (k - 1)) *
+	         sqrt(2 * b * (1 - Tf / (b * (k - 1))) * (A - C) / ((b - 1) * (k - 1)));
+	for(c = 0; c < n; c++)
+		if(vivo[c] && (soma_posto[c] - soma_posto[melhor] > limite)){
+			vivo[c] = 0;
+			eliminadas++;
+		}
+	return eliminadas;
+}
+
+/*
+ * AJUSTAPARAMETROS: Corrida de configurações do SA sobre as instâncias
+ *
+ * 1. Sorteia n configurações em torno de param (a primeira é o próprio param)
+ * 2. A cada instância, roda todas as vivas com o mesmo prazo e semente
+ * 3. A partir de minimo instâncias, elimina pelo teste de Friedman as
+ *    estatisticamente piores
+ * 4. Termina sem instâncias ou com uma configuração; grava em saida a de
+ *    menor soma de postos
+ *
+ * Com perfil (não NULL), acrescenta em saida um perfil com esse nome e a
+ * média das características das instâncias (ver PERFIS DE PARÂMETROS).
+ * Retorna 1 se gravou o arquivo de parâmetros.
+ */
+int ajustaParametros(char instancias[][SIZE], int ninst, int n, double prazo, int minimo,
+                     unsigned long long semente, char *saida, char *perfil){
+	ParametrosSA *conf;
+	int *vivo, c, s, k, etapas = 0, vivas = n, melhor = 0;
+	long long *fo;
+	double *posto, *soma_posto, media[NUM_CARACTERISTICAS] = {0};
+	FILE *fp;
+
+	if(n < 1) n = 1;
+	conf = (ParametrosSA*) malloc(n * sizeof(ParametrosSA));
+	vivo = (int*) malloc(n * sizeof(int));
+	fo = (long long*) malloc(ninst * n * sizeof(long long));
+	posto = (double*) malloc(ninst * n * sizeof(double));
+	soma_posto = (double*) malloc(n * sizeof(double));
+
+	estado_rng = (semente != 0) ? semente : 1;
+	conf[0] = param;
+	for(c = 1; c < n; c++)
+		sorteiaParametros(&conf[c], &param);
+	for(c = 0; c < n; c++) vivo[c] = 1;
+
+	// Sem arquivos auxiliares nas execuções da corrida
+	arquivo_checkpoint[0] = arquivo_despejo[0] = arquivo_incumbente[0] = arquivo_traco[0] = '\0';
+	if(nivel_log == LOG_INFO)
+		nivel_log = LOG_AVISO;
+
+	printf("\nCorrida: %d configurações, %d instâncias, %.1fs por execução, %d em paralelo\n",
+	       n, ninst, prazo, numThreads());
+	for(s = 0; (s < ninst) && (vivas > 1) && !atomic_load(&parar_busca); s++){
+		if(!preparaInstancia(instancias[s], NULL)){
+			printf("Instância %s ignorada (não pôde ser lida)\n", instancias[s]);
+			continue;
+		}
+		for(k = 0; k < NUM_CARACTERISTICAS; k++)
+			media[k] += caracteristicas[k];
+		executaConfiguracoes(conf, vivo, n, (semente + s + 1) * 0x9e3779b97f4a7c15ULL, prazo, fo + etapas * n);
+		if(atomic_load(&parar_busca)) break;  // Instância interrompida não entra nos postos
+		etapas++;
+
+		if(etapas >= minimo)
+			vivas -= eliminaFriedman(fo, etapas, n, vivo, posto, soma_posto);
+		else
+			postosFriedman(fo, etapas, n, vivo, posto, soma_posto);
+		for(c = 0; c < n; c++)
+			if(vivo[c] && (!vivo[melhor] || (soma_posto[c] < soma_posto[melhor]))) melhor = c;
+		printf("%-24s vivas: %2d  melhor: #%d (FO %lld, posto médio %.2f)\n", instancias[s], vivas,
+		       melhor, fo[(etapas - 1) * n + melhor], soma_posto[melhor] / etapas);
+	}
+
+	if(etapas > 0){
+		printf("\nConfigurações restantes (posto médio em %d instâncias):\n", etapas);
+		for(c = 0; c < n; c++)
+			if(vivo[c]) printf("  #%-3d %.2f%s\n", c, soma_posto[c] / etapas, (c == 0) ? " (inicial)" : "");
+
+		fp = fopen(saida, (perfil != NULL) ? "a" : "w");
+		if(fp){
+			fprintf(fp, "# Corrida: configuração #%d de %d, %d instâncias, %.1fs por execução\n",
+			        melhor, n, etapas, prazo);
+			if(perfil != NULL){
+				fprintf(fp, "perfil %s", perfil);
+				for(k = 0; k < NUM_CARACTERISTICAS; k++)
+					fprintf(fp, " %.6f", media[k] / etapas);
+				fprintf(fp, "\n");
+			}
+			gravaParametros(fp, &conf[melhor]);
+			fclose(fp);
+			if(perfil != NULL)
+				printf("\nPerfil %s acrescentado em %s (use -P %s)\n", perfil, saida, saida);
+			else
+				printf("\nParâmetros gravados em %s (use -p %s)\n", saida, saida);
+		}
+		else{
+			printf("ERRO! - Não foi possível criar %s\n", saida);
+			etapas = 0;
+		}
+	}
+
+	free(conf);
+	free(vivo);
+	free(fo);
+	free(posto);
+	free(soma_posto);
+	return etapas > 0;
+}
+
+// ============================================================================
+// PERFIS DE PARÂMETROS POR CARACTERÍSTICAS DA INSTÂNCIA
+// ============================================================================
+
+/*
+ * Tabela de perfis (-P ARQUIVO): cada perfil começa com
+ *   perfil NOME ocupação escassez densidade indisponibilidade
+ * seguido das chaves do arquivo de parâmetros que diferem do padrão. A
+ * corrida grava perfis nesse formato com perfil=NOME. Cada instância lida
+ * por construcao usa o perfil de características mais próximas.
+ */
+typedef struct perfil{
+	char nome[SIZE];                          // Nome do perfil
+	double caracteristica[NUM_CARACTERISTICAS];  // Características das instâncias do ajuste
+	ParametrosSA p;                           // Parâmetros ajustados
+}Perfil;
+
+Perfil perfis[MAX_PERFIS];  // Tabela de perfis lida com -P
+int num_perfis = 0;
+
+/*
+ * LEPERFIS: Lê a tabela de perfis; cada perfil parte dos parâmetros atuais
+ * Retorna 1 se leu pelo menos um perfil válido, 0 caso contrário
+ */
+int lePerfis(char *arquivo){
+	FILE *fp = fopen(arquivo, "r");
+	char linha[SIZE * 4], chave[SIZE];
+	int desloc, ok = 1;
+
+	if(!fp){
+		printf("ERRO! - Não foi possível abrir os perfis %s\n", arquivo);
+		return 0;
+	}
+	num_perfis = 0;
+	while(ok && fgets(linha, sizeof(linha), fp)){
+		if((sscanf(linha, "%99s%n", chave, &desloc) != 1) || (chave[0] == '#')) continue;
+
+		if(strcmp(chave, "perfil") == 0){
+			Perfil *novo = &perfis[num_perfis];
+			char *resto = linha + desloc;
+			if((num_perfis > 0) && !parametrosValidos(&perfis[num_perfis - 1].p))
+				break;  // Perfil anterior completo e inválido (mensagem abaixo)
+			if((num_perfis == MAX_PERFIS) || (sscanf(resto, "%99s%n", novo->nome, &desloc) != 1) ||
+			   (leValores(resto + desloc, novo->caracteristica, NUM_CARACTERISTICAS) != NUM_CARACTERISTICAS)){
+				printf("ERRO! - %s: perfil incompleto ou perfis demais: %s", arquivo, linha);
+				ok = 0;
+			}
+			else{
+				novo->p = param;
+				num_perfis++;
+			}
+		}
+		else if((num_perfis == 0) || !leLinhaParametro(chave, linha + desloc, &perfis[num_perfis - 1].p)){
+			printf("ERRO! - %s: linha fora de um perfil ou inválida: %s", arquivo, linha);
+			ok = 0;
+		}
+	}
+	// Cada perfil é validado inteiro, ao começar o próximo ou no fim do
+	// arquivo: a ordem das chaves dentro dele não importa
+	if(ok && (num_perfis > 0) && !parametrosValidos(&perfis[num_perfis - 1].p)){
+		printf("ERRO! - %s: parâmetros fora dos limites no perfil %s\n", arquivo, perfis[num_perfis - 1].nome);
+		ok = 0;
+	}
+	fclose(fp);
+	if(!ok) num_perfis = 0;
+	return num_perfis > 0;
+}
+
+/*
+ * ESCOLHEPERFIL: Aplica em param o perfil mais próximo da instância lida
+ * Distância euclidiana com cada característica dividida pela sua
+ * amplitude na tabela (características constantes não pesam).
+ */
+void escolhePerfil(){
+	double menor[NUM_CARACTERISTICAS], maior[NUM_CARACTERISTICAS], dist, melhor_dist = -1, x;
+	int i, k, melhor = 0;
+
+	if(num_perfis == 0) return;
+	for(k = 0; k < NUM_CARACTERISTICAS; k++){
+		menor[k] = maior[k] = perfis[0].caracteristica[k];
+		for(i = 1; i < num_perfis; i++){
+			if(perfis[i].caracteristica[k] < menor[k]) menor[k] = perfis[i].caracteristica[k];
+			if(perfis[i].caracteristica[k] > maior[k]) maior[k] = perfis[i].caracteristica[k];
+		}
+	}
+	for(i = 0; i < num_perfis; i++){
+		dist = 0;
+		for(k = 0; k < NUM_CARACTERISTICAS; k++)
+			if(maior[k] > menor[k]){
+				x = (caracteristicas[k] - perfis[i].caracteristica[k]) / (maior[k] - menor[k]);
+				dist += x * x;
+			}
+		if((melhor_dist < 0) || (dist < melhor_dist)){
+			melhor_dist = dist;
+			melhor = i;
+		}
+	}
+	param = perfis[melhor].p;
+	printf("Perfil de parâmetros: %s (distância %.3f)\n", perfis[melhor].nome, sqrt(melhor_dist));
+}
+
+/*
+ * IMPRIMECARACTERISTICAS: Mostra o vetor de características da instância
+ */
+void imprimeCaracteristicas(FILE *fp){
+	int k;
+
+	fprintf(fp, "Características:");
+	for(k = 0; k < NUM_CARACTERISTICAS; k++)
+		fprintf(fp, "%s %s %.4f", (k > 0) ? "," : "", nome_caracteristica[k], caracteristicas[k]);
+	fprintf(fp, "\n");
+}
+
 // ============================================================================
 // FUNÇÃO PRINCIPAL
 // ============================================================================
@@ -2094,7 +6856,7 @@ void imprimeViolacoes(){
 // ============================================================================
 
 int** extraiDiasDaMatriz(Matriz matriz_integral, int num_profs, int num_dias, int periodos_total, int periodos_por_dia){
-    int i, j, dis, prof, dia;
+    int i, j, dis, prof, per, dia;
     
     // Aloca matriz de dias [professores][dias]
     int** dias_ocupados = (int**) malloc(num_profs * sizeof(int*));
@@ -2106,17 +6868,16 @@ int** extraiDiasDaMatriz(Matriz matriz_integral, int num_profs, int num_dias, in
         }
     }
     
-    // Percorre toda a matriz da grade integral
-    for(i = 0; i < periodos_total; i++){
-        for(j = 0; j < salas; j++){
-            dis = matriz_integral.n[i][j];  // Disciplina alocada
-            
-            if(dis != -1){  // Se há disciplina alocada
-                prof = disc[dis].prof;      // ID do professor
-                dia = i / periodos_por_dia; // Extrai o dia do período
+    // Percorre as aulas de cada professor (lista de aulas da grade integral)
+    for(prof = 0; (prof < num_profs) && (prof < professores); prof++){
+        for(i = 0; i < qtDiscProf[prof]; i++){
+            dis = discProf[prof][i];  // Disciplina do professor
+            for(j = primeira_aula[dis]; j < primeira_aula[dis] + disc[dis].aulas; j++){
+                per = matriz_integral.pos[j] / salas;  // Período da aula
+                dia = per / periodos_por_dia;          // Dia da aula
                 
                 // Segurança: verifica limites
-                if(prof < num_profs && dia < num_dias){
+                if((per >= 0) && (per < periodos_total) && (dia < num_dias)){
                     dias_ocupados[prof][dia] = 1;  // Marca que professor trabalha neste dia
                 }
             }
@@ -2129,23 +6890,22 @@ int** extraiDiasDaMatriz(Matriz matriz_integral, int num_profs, int num_dias, in
 Matriz construcao(char *arquivo_entrada, char *arquivo_saida, int **dias_integral, int usar_integral){
 
 	Matriz matriz;
-	int i;
+	long long fo_antes;  // FO da solução inicial, antes da decomposição
+	double limite;       // Fim da decomposição pelo relógio (-s ou -b; 0 = sem limite)
+	double prazo_anterior = prazo_sa;
 
 	T = 10000;
 	execucao = 0;
 
-	printf("\e[H\e[2J");  // Limpa terminal
+	limpaTerminal();
 	programa = 1;
-	
-	// Inicializa contadores
-	professores = 0;
-	disciplinas = 0;
-	salas = 0;
-	dias = 0;
-	periodos_dia = 0;
-	cursos = 0;
-	restricoes = 0;
 
+	// Conjunto elite da instância anterior (liberado antes de mudar os tamanhos)
+	if(elite != NULL){
+		liberaElite(elite);
+		elite = NULL;
+	}
+	
 	if(rotina == 0){
 		num_exec = 1;  // Número de execuções
 	}
@@ -2157,19 +6917,65 @@ Matriz construcao(char *arquivo_entrada, char *arquivo_saida, int **dias_integra
 	}
 	
 	
+#ifdef CONTADORES_HW
+	iniciaContadores();  // Contadores por fase desta grade
+#endif
+	INICIO_FASE(FASE_LEITURA);
 	if(!leArquivos(arquivo_entrada)){
 		printf("\n\nERRO! - Houve um problema para ler o arquivo. Tente novamente\n\n");
 		matriz.fo = -1;
 		return matriz;
 	}
+	FIM_FASE(FASE_LEITURA);
+	iniciaZobrist();  // Chaves de hash da instância
+	elite = criaElite(TAM_ELITE);  // Conjunto elite da instância
+	decompoeInstancia();  // Componentes independentes do grafo de conflitos
 	
-	printf("\e[H\e[2J");
+	limpaTerminal();
+
+	// Perfil de parâmetros mais próximo (tabela lida com -P)
+	imprimeCaracteristicas(stdout);
+	escolhePerfil();
+
+	// Provas de inviabilidade (contagem e emparelhamento), antes da busca
+	if(verificaViabilidade() > 0)
+		printf("Nenhuma grade zera as restrições graves: a busca minimiza as violações.\n");
+	limiteInferior();  // O SA para ao atingir o limite
+
+	// Checkpoint desta grade (o SA retoma dele se retomar = 1)
+	sprintf(arquivo_checkpoint, "%s.ckpt", arquivo_saida);
+	sprintf(arquivo_despejo, "%s.parcial", arquivo_saida);  // Destino do SIGUSR1
+	sprintf(arquivo_incumbente, "%s.melhor", arquivo_saida);  // Melhor solução durante o SA
+	sprintf(arquivo_traco, (formato_traco == TRACO_CSV) ? "%s.traco.csv" : "%s.traco", arquivo_saida);
 	
-	// Gera solução inicial
-	matriz = solucaoInicial();
+	if(existeCheckpoint()){
+		// Solução inicial vem do checkpoint
+		matriz = criaMatriz();
+	}
+	else if((arquivo_partida != NULL) && carregaPartida(arquivo_partida, &matriz)){
+		// Grade anterior: SA curto em temperatura baixa, sem decomposição (refaria a grade)
+		temperatura_partida = TEMP_PARTIDA;
+		if(prazo_sa <= 0)
+			prazo_sa = PRAZO_PARTIDA;
+	}
+	else{
+		// Gera solução inicial
+		INICIO_FASE(FASE_CONSTRUCAO);
+		matriz = solucaoInicial();
+
+		// Componentes independentes resolvidos em paralelo antes do SA
+		fo_antes = matriz.fo;
+		limite = (prazo_sa > 0) ? relogio() + prazo_sa :
+		         ((estrategia_reinicio != REINICIO_NENHUM) ? relogio() + orcamento_reinicio : 0);
+		if(solucaoDecomposta(&matriz, numThreads(), limite) > 0)
+			printf("\nDecomposição: %d componentes, fo %lld -> %lld\n", num_componentes, fo_antes, matriz.fo);
+		FIM_FASE(FASE_CONSTRUCAO);
+	}
 	
-	// Aplica Simulated Annealing
-	matriz = SA(matriz);
+	// Aplica Simulated Annealing (um só ou em episódios com reinícios)
+	matriz = (estrategia_reinicio != REINICIO_NENHUM) ? reinicios(matriz) : SA(matriz);
+	temperatura_partida = 0;
+	prazo_sa = prazo_anterior;
 	
 	// Recalcula FO final
 	calcula_FO(matriz);
@@ -2179,6 +6985,9 @@ Matriz construcao(char *arquivo_entrada, char *arquivo_saida, int **dias_integra
 
 	// Exibe relatório de violações
 	imprimeViolacoes();
+#ifdef CONTADORES_HW
+	relatorioContadores(stdout);
+#endif
 	
 	
 	salvaResultado(matriz, arquivo_saida);
@@ -2189,19 +6998,218 @@ Matriz construcao(char *arquivo_entrada, char *arquivo_saida, int **dias_integra
 	return matriz;
 }
 
-int main(){
+int main(int argc, char *argv[]){
     Matriz integral, noturno;
     int** dias_integral = NULL;
     
     int num_dias_integral, periodos_total_integral, periodos_por_dia_integral;
+
+    // Modos do gerador de instâncias e do teste de escala
+    ParametrosGerador gerador = parametrosPadrao();
+    char *arquivo_gerado = NULL;
+    int escala = 0;
+    int tamanhos[MAX_TAMANHOS] = {25, 50, 100, 300, 1000, 3000, 10000};
+    int num_tamanhos = 7;
+    double prazo_escala = PRAZO_ESCALA;
+    char prefixo_escala[SIZE * 2] = "escala";
+
+    // Corrida de parâmetros
+    char *arquivo_ajuste = NULL;
+    char instancias[MAX_INSTANCIAS][SIZE];
+    int num_instancias = 21;
+    int configuracoes = CONFIGURACOES_AJUSTE, etapas_minimas = ETAPAS_MINIMAS;
+    double prazo_ajuste = PRAZO_AJUSTE;
+    unsigned long long semente_ajuste = 1;
+    char *perfil_ajuste = NULL;
+
+    // Grades anteriores (-w): integral e noturna
+    char *partida_integral = NULL, *partida_noturno = NULL;
+
+    for(int i = 0; i < num_instancias; i++)
+        sprintf(instancias[i], "inst%d", i + 1);
+
+    // Sinais tratados por uma thread própria (antes de criar qualquer outra)
+    iniciaSinais();
+
+    // ========================================================================
+    // OPÇÕES DE LINHA DE COMANDO
+    // ========================================================================
+
+    for(int i = 1; i < argc; i++){
+        if((strcmp(argv[i], "-r") == 0) || (strcmp(argv[i], "--retomar") == 0))
+            retomar = 1;
+        else if(((strcmp(argv[i], "-k") == 0) || (strcmp(argv[i], "--checkpoint") == 0)) && (i + 1 < argc))
+            intervalo_checkpoint = atoi(argv[++i]);
+        else if(((strcmp(argv[i], "-i") == 0) || (strcmp(argv[i], "--intervalo-melhor") == 0)) && (i + 1 < argc))
+            intervalo_incumbente = atof(argv[++i]);
+        else if((strcmp(argv[i], "-q") == 0) || (strcmp(argv[i], "--silencioso") == 0))
+            nivel_log = LOG_AVISO;
+        else if((strcmp(argv[i], "-v") == 0) || (strcmp(argv[i], "--detalhado") == 0))
+            nivel_log = LOG_DEPURACAO;
+        else if((strcmp(argv[i], "-j") == 0) || (strcmp(argv[i], "--json") == 0))
+            log_json = 1;
+        else if(((strcmp(argv[i], "-d") == 0) || (strcmp(argv[i], "--verifica") == 0)) && (i + 1 < argc))
+            intervalo_verificacao = atoi(argv[++i]);
+        else if(((strcmp(argv[i], "-t") == 0) || (strcmp(argv[i], "--traco") == 0)) && (i + 1 < argc)){
+            i++;
+            if(strcmp(argv[i], "csv") == 0) formato_traco = TRACO_CSV;
+            else if(strcmp(argv[i], "bin") == 0) formato_traco = TRACO_BINARIO;
+            else formato_traco = TRACO_NENHUM;
+        }
+        else if(((strcmp(argv[i], "-g") == 0) || (strcmp(argv[i], "--gera") == 0)) && (i + 1 < argc))
+            arquivo_gerado = argv[++i];
+        else if((strcmp(argv[i], "-e") == 0) || (strcmp(argv[i], "--escala") == 0))
+            escala = 1;
+        else if(escala && (strncmp(argv[i], "tamanhos=", 9) == 0)){
+            char *t = strtok(argv[i] + 9, ",");
+            for(num_tamanhos = 0; (t != NULL) && (num_tamanhos < MAX_TAMANHOS); t = strtok(NULL, ","))
+                tamanhos[num_tamanhos++] = atoi(t);
+        }
+        else if(escala && (strncmp(argv[i], "prazo=", 6) == 0))
+            prazo_escala = atof(argv[i] + 6);
+        else if(escala && (strncmp(argv[i], "saida=", 6) == 0))
+            snprintf(prefixo_escala, sizeof(prefixo_escala), "%s", argv[i] + 6);
+        else if((arquivo_gerado != NULL || escala) && leParametroGerador(&gerador, argv[i]))
+            ;  // Parâmetro do gerador (chave=valor)
+        else if(((strcmp(argv[i], "-p") == 0) || (strcmp(argv[i], "--parametros") == 0)) && (i + 1 < argc)){
+            if(!leParametros(argv[++i], &param))
+                return 1;
+        }
+        else if(((strcmp(argv[i], "-a") == 0) || (strcmp(argv[i], "--ajusta") == 0)) && (i + 1 < argc))
+            arquivo_ajuste = argv[++i];
+        else if(arquivo_ajuste && (strncmp(argv[i], "instancias=", 11) == 0)){
+            char *t = strtok(argv[i] + 11, ",");
+            for(num_instancias = 0; (t != NULL) && (num_instancias < MAX_INSTANCIAS); t = strtok(NULL, ","))
+                snprintf(instancias[num_instancias++], SIZE, "%s", t);
+        }
+        else if(arquivo_ajuste && (strncmp(argv[i], "configuracoes=", 14) == 0))
+            configuracoes = atoi(argv[i] + 14);
+        else if(arquivo_ajuste && (strncmp(argv[i], "minimo=", 7) == 0))
+            etapas_minimas = atoi(argv[i] + 7);
+        else if(arquivo_ajuste && (strncmp(argv[i], "prazo=", 6) == 0))
+            prazo_ajuste = atof(argv[i] + 6);
+        else if(arquivo_ajuste && (strncmp(argv[i], "semente=", 8) == 0))
+            semente_ajuste = strtoull(argv[i] + 8, NULL, 10);
+        else if(((strcmp(argv[i], "-R") == 0) || (strcmp(argv[i], "--reinicio") == 0)) && (i + 1 < argc)){
+            i++;
+            if(strcmp(argv[i], "luby") == 0) estrategia_reinicio = REINICIO_LUBY;
+            else if(strncmp(argv[i], "geo", 3) == 0) estrategia_reinicio = REINICIO_GEOMETRICO;
+            else estrategia_reinicio = REINICIO_NENHUM;
+        }
+        else if(((strcmp(argv[i], "-b") == 0) || (strcmp(argv[i], "--orcamento") == 0)) && (i + 1 < argc))
+            orcamento_reinicio = atof(argv[++i]);
+        else if(((strcmp(argv[i], "-u") == 0) || (strcmp(argv[i], "--unidade") == 0)) && (i + 1 < argc))
+            unidade_reinicio = atof(argv[++i]);
+        else if(arquivo_ajuste && (strncmp(argv[i], "perfil=", 7) == 0))
+            perfil_ajuste = argv[i] + 7;
+        else if(((strcmp(argv[i], "-P") == 0) || (strcmp(argv[i], "--perfis") == 0)) && (i + 1 < argc)){
+            if(!lePerfis(argv[++i]))
+                return 1;
+        }
+        else if(((strcmp(argv[i], "-s") == 0) || (strcmp(argv[i], "--prazo") == 0)) && (i + 1 < argc))
+            prazo_sa = atof(argv[++i]);
+        else if((strcmp(argv[i], "-T") == 0) || (strcmp(argv[i], "--tabu") == 0))
+            param.tabu = 1;
+        else if(((strcmp(argv[i], "-w") == 0) || (strcmp(argv[i], "--partida") == 0)) && (i + 1 < argc)){
+            char *virgula = strchr(argv[++i], ',');
+            if(virgula != NULL){
+                *virgula = '\0';
+                partida_noturno = (virgula[1] != '\0') ? virgula + 1 : NULL;
+            }
+            partida_integral = (argv[i][0] != '\0') ? argv[i] : NULL;
+        }
+        else if(((strcmp(argv[i], "-l") == 0) || (strcmp(argv[i], "--log") == 0)) && (i + 1 < argc)){
+            saida_log = fopen(argv[++i], "w");
+            if(saida_log == NULL){
+                printf("ERRO! - Não foi possível criar o log %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else{
+            printf("Uso: %s [-r|--retomar] [-k|--checkpoint N] [-i|--intervalo-melhor S]\n", argv[0]);
+            printf("        [-q|--silencioso] [-v|--detalhado] [-j|--json] [-l|--log ARQUIVO]\n");
+            printf("        [-t|--traco bin|csv|nao] [-d|--verifica N]\n");
+            printf("        [-g|--gera ARQUIVO chave=valor...] [-e|--escala chave=valor...]\n");
+            printf("        [-p|--parametros ARQUIVO] [-P|--perfis ARQUIVO] [-a|--ajusta SAIDA chave=valor...]\n");
+            printf("        [-R|--reinicio luby|geometrico|nao] [-b|--orcamento S] [-u|--unidade S]\n");
+            printf("        [-s|--prazo S] [-w|--partida INTEGRAL[,NOTURNA]] [-T|--tabu]\n");
+            printf("  -r  retoma cada grade do seu checkpoint (<saida>.ckpt)\n");
+            printf("  -k  passos de temperatura entre checkpoints (0 desliga, padrão %d)\n", INTERVALO_CHECKPOINT);
+            printf("  -i  segundos mínimos entre gravações de <saida>.melhor (padrão %.1f)\n", INTERVALO_INCUMBENTE);
+            printf("  -q  log só com avisos e erros; -v inclui a depuração\n");
+            printf("  -j  log em JSON (um evento por linha); -l grava o log em ARQUIVO\n");
+            printf("  -t  traço de convergência em <saida>.traco (bin, padrão), .traco.csv ou nenhum\n");
+            printf("  -d  confere o delta contra calcula_FO a cada N iterações (0 desliga)\n");
+            printf("  -g  grava uma instância sintética em ARQUIVO e termina; chaves: disciplinas,\n");
+            printf("      salas, tipos, cursos, densidade, professores, indisponibilidade, dias,\n");
+            printf("      periodos, semente (salas, cursos e professores 0 = automático)\n");
+            printf("  -e  teste de escala em instâncias sintéticas; além das chaves do gerador:\n");
+            printf("      tamanhos=25,50,... prazo=S (SA por tamanho, padrão %.0f) saida=PREFIXO\n", PRAZO_ESCALA);
+            printf("  -p  lê os parâmetros do SA e do geraViz de ARQUIVO\n");
+            printf("  -P  tabela de perfis: cada grade usa o de características mais próximas\n");
+            printf("  -a  corrida de configurações (Friedman) e grava a melhor em SAIDA; chaves:\n");
+            printf("      instancias=inst1,... configuracoes=N (padrão %d) prazo=S (padrão %.0f)\n",
+                   CONFIGURACOES_AJUSTE, PRAZO_AJUSTE);
+            printf("      minimo=N (instâncias antes de eliminar, padrão %d) semente=N\n", ETAPAS_MINIMAS);
+            printf("      perfil=NOME (acrescenta em SAIDA um perfil para -P)\n");
+            printf("  -R  episódios de SA com durações de Luby ou geométricas (razão %.1f)\n", RAZAO_REINICIO);
+            printf("  -b  segundos por grade com -R, religação e polimento incluídos (padrão %.0f); -u  duração unitária (padrão %.0f)\n",
+                   ORCAMENTO_REINICIO, UNIDADE_REINICIO);
+            printf("  -s  segundos por grade de SA, religação e polimento (0 = sem prazo, padrão; com -w, %.0f)\n", PRAZO_PARTIDA);
+            printf("  -w  parte das grades anteriores (relatório ou .sol) com o SA a T = %.1f;\n", TEMP_PARTIDA);
+            printf("      disciplinas e salas casam pelo nome (vazio = solução inicial)\n");
+            printf("  -T  proíbe voltar aos %d últimos estados aceitos (chave tabu 1 em -p)\n", DURACAO_TABU);
+            return 1;
+        }
+    }
+
+    // Os episódios de reinício não gravam checkpoint
+    if(retomar && (estrategia_reinicio != REINICIO_NENHUM)){
+        printf("Aviso: -r ignorado com -R (episódios de reinício não têm checkpoint)\n");
+        retomar = 0;
+    }
+
+    // Log assíncrono (fila sem trava e thread própria)
+    iniciaLog();
+
+    // Instância sintética: grava e termina
+    if(arquivo_gerado != NULL){
+        if(!geraInstancia(&gerador, arquivo_gerado)){
+            printf("ERRO! - Não foi possível criar %s\n", arquivo_gerado);
+            encerraLog();
+            return 1;
+        }
+        printf("Instância %s: %d disciplinas, %d salas (%d tipos), %d currículos, %d professores, %d x %d períodos\n",
+               arquivo_gerado, gerador.disciplinas, gerador.salas, gerador.tipos, gerador.cursos,
+               gerador.professores, gerador.dias, gerador.periodos_dia);
+        encerraLog();
+        return 0;
+    }
+
+    // Corrida de parâmetros: grava a melhor configuração e termina
+    if(arquivo_ajuste != NULL){
+        int gravou = ajustaParametros(instancias, num_instancias, configuracoes, prazo_ajuste,
+                                      etapas_minimas, semente_ajuste, arquivo_ajuste, perfil_ajuste);
+        encerraLog();
+        return gravou ? 0 : 1;
+    }
+
+    // Teste de escala: tempos por tamanho de instância e termina
+    if(escala){
+        testeEscala(gerador, tamanhos, num_tamanhos, prazo_escala, prefixo_escala);
+        encerraLog();
+        return 0;
+    }
     
     // ========================================================================
     // GRADE 1: INTEGRAL
     // ========================================================================
     
+    arquivo_partida = partida_integral;
     integral = construcao("instUnifesp_integral", "resultados/instUnifesp_integral7", NULL, 0);
     
     if(integral.fo == -1){
+        encerraLog();
         return 1;
     }
     
@@ -2226,15 +7234,23 @@ int main(){
     // GRADE 2: NOTURNA
     // ========================================================================
     
-	rotina = 1;
-    noturno = construcao("instUnifesp_noturno", "resultados/instUnifesp_noturno7", dias_integral, 1);
-    
-    if(noturno.fo == -1){
-        for(int i = 0; i < num_profs_da_integral; i++){
-            free(dias_integral[i]);
+    // Parada pedida por sinal: a grade integral foi salva, a noturna fica de fora
+    if(atomic_load(&parar_busca)){
+        printf("\nBusca interrompida: grade noturna não construída.\n");
+    }
+    else{
+        rotina = 1;
+        arquivo_partida = partida_noturno;
+        noturno = construcao("instUnifesp_noturno", "resultados/instUnifesp_noturno7", dias_integral, 1);
+        
+        if(noturno.fo == -1){
+            for(int i = 0; i < num_profs_da_integral; i++){
+                free(dias_integral[i]);
+            }
+            free(dias_integral);
+            encerraLog();
+            return 1;
         }
-        free(dias_integral);
-        return 1;
     }
     
     // ========================================================================
@@ -2252,7 +7268,6 @@ int main(){
         free(r21[i]);
         free(r22[i]);
         free(aux_mov_r6[i]);
-        free(aux_mov_r11[i]);
     }
     
     for(int i = 0; i < disciplinas; i++){
@@ -2260,10 +7275,12 @@ int main(){
         free(aux_mov_r7[i]);
         free(aux_mov_r10[i]);
         free(disc[i].cursos);
+        free(disc[i].listaCursos);
     }
     
     for(int i = 0; i < professores; i++){
         free(r9[i]);
+        free(discProf[i]);
     }
     
     for(int i = 0; i < dias; i++){
@@ -2274,7 +7291,6 @@ int main(){
     free(r21);
     free(r22);
     free(aux_mov_r6);
-    free(aux_mov_r11);
     free(r5);
     free(r9);
     free(r11);
@@ -2288,8 +7304,11 @@ int main(){
     free(aux_mov_r5);
     free(aux_mov_r8);
     free(aux_mov_r9);
-    free(r1);
     free(r8);
+    free(discProf);
+    free(qtDiscProf);
+    free(primeira_aula);
+    free(aula_disc);
     
     // Libera dados do problema
     free(disc);
@@ -2303,9 +7322,15 @@ int main(){
     free(restricao);
     free(posicao_restricao[0]);
     free(posicao_restricao[1]);
+    free(traco.dados);
     
     printf("\n\n✓ Todas as grades foram criadas com sucesso!\n\n");
     
+    encerraLog();
+#ifdef SONDAS
+    relatorioSondas(stdout);
+#endif
+    
     return 0;
 }
 